@@ -0,0 +1,146 @@
+#pragma once
+
+#include "markov_chain.h"
+#include "thread_pool.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/// Scores a batch of observation sequences, e.g. the protocol of every machine of a fleet, against
+/// markov chains on a work-stealing thread pool. Jobs run longest first and idle workers
+/// steal from busy ones, so very uneven sequence lengths are balanced. Every worker keeps its own
+/// forward variables, which are only reallocated for a model of a larger state count, and every
+/// result is passed on as soon as its job is finished.
+/// \tparam chain Type of the markov chains, e.g. markov_chain<>.
+template<typename chain>
+class batch_scorer
+{
+public:
+  /// A single sequence to score against a single model.
+  struct job
+  {
+    std::uint64_t id;                ///< identifies the job within its result
+    const chain* model;
+    const std::uint64_t* sequence;
+    std::uint64_t length;
+  };
+
+  /// Result of a single job.
+  struct result
+  {
+    std::uint64_t id;
+    double log_likelihood;
+    double seconds;
+  };
+
+  /// Define the scorer.
+  /// \param _thread_pool worker threads to score on.
+  batch_scorer(thread_pool& _thread_pool);
+
+  /// Score every job and wait for all of them to finish. The models and sequences have to stay
+  /// valid until then.
+  /// \param _jobs jobs to score.
+  /// \param _callback receives the result of each job as soon as it is finished. Calls are
+  ///   serialized, so the callback does not need to be thread-safe.
+  void score(const std::vector<job>& _jobs, std::function<void(const result&)> _callback);
+
+  /// Score every job and wait for all of them to finish.
+  /// \param _jobs jobs to score.
+  /// \return the result of each job, in the order of the jobs.
+  std::vector<result> score(const std::vector<job>& _jobs);
+
+private:
+  /// Forward variables of a single worker.
+  struct scratch
+  {
+    Eigen::RowVectorXd alpha;
+    Eigen::RowVectorXd next;
+  };
+
+  /// Compute the log-likelihood of a job by the scaled forward algorithm of its model.
+  /// \param _job job to score.
+  /// \param _scratch forward variables of the calling worker.
+  /// \return natural logarithm of the probability of the sequence.
+  static double forward(const job& _job, scratch& _scratch);
+
+  /// Worker threads.
+  thread_pool& m_thread_pool;
+
+  /// Forward variables of each worker.
+  std::vector<scratch> m_scratch;
+};
+
+// -------------------------------------------------------------------------------------------------
+// implementation
+// -------------------------------------------------------------------------------------------------
+
+template<typename chain>
+batch_scorer<chain>::batch_scorer(thread_pool& _thread_pool)
+  : m_thread_pool(_thread_pool)
+  , m_scratch(_thread_pool.thread_count())
+{
+  /* empty */
+}
+
+template<typename chain>
+void batch_scorer<chain>::score(const std::vector<job>& _jobs, std::function<void(const result&)> _callback)
+{
+  MATE_TRACE_SCOPE("batch_scorer::score");
+
+  // longest processing time first
+  std::vector<std::uint64_t> order(_jobs.size());
+  for (std::uint64_t i = 0; i < order.size(); i++) { order[i] = i; }
+  std::sort(order.begin(), order.end(), [&_jobs](const std::uint64_t _a, const std::uint64_t _b)
+  {
+    return _jobs[_a].length * _jobs[_a].model->initial_state().size() > _jobs[_b].length * _jobs[_b].model->initial_state().size();
+  });
+
+  std::mutex callback_mutex;
+  for (const std::uint64_t i : order)
+  {
+    const job* current = &_jobs[i];
+    m_thread_pool.submit([this, current, &_callback, &callback_mutex]
+    {
+      const auto start = std::chrono::steady_clock::now();
+
+      result r;
+      r.id = current->id;
+      r.log_likelihood = forward(*current, m_scratch[m_thread_pool.worker_index()]);
+      r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      std::lock_guard<std::mutex> lock(callback_mutex);
+      _callback(r);
+    });
+  }
+  m_thread_pool.wait();
+}
+
+template<typename chain>
+std::vector<typename batch_scorer<chain>::result> batch_scorer<chain>::score(const std::vector<job>& _jobs)
+{
+  std::vector<result> results(_jobs.size());
+
+  // results arrive in any order, so the jobs are identified by their position while scoring
+  std::vector<job> jobs = _jobs;
+  for (std::uint64_t i = 0; i < jobs.size(); i++) { jobs[i].id = i; }
+
+  score(jobs, [&results, &_jobs](const result& _result)
+  {
+    results[_result.id] = _result;
+    results[_result.id].id = _jobs[_result.id].id;
+  });
+
+  return results;
+}
+
+template<typename chain>
+double batch_scorer<chain>::forward(const job& _job, scratch& _scratch)
+{
+  return _job.model->log_likelihood(_job.length, _job.sequence, _scratch.alpha, _scratch.next);
+}
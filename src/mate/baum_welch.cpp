@@ -0,0 +1,281 @@
+#include "baum_welch.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+baum_welch::baum_welch(
+  markov_chain<discrete_distribution>& _markov_chain,
+  thread_pool& _thread_pool
+) : m_markov_chain(_markov_chain)
+  , m_thread_pool(_thread_pool)
+{
+  /* empty */
+}
+
+std::vector<baum_welch::iteration> baum_welch::train(
+  const std::vector<std::vector<std::uint64_t>>& _sequences,
+  const std::uint64_t _iterations,
+  const double _epsilon)
+{
+  std::vector<iteration> result;
+
+  if (_sequences.empty()) { return result; }
+
+  // every symbol has to be within the widest emission distribution, the emission matrix is read
+  // unchecked in the expectation step
+  const std::vector<discrete_distribution>& distributions = m_markov_chain.emission_distributions();
+  const auto widest = std::max_element(distributions.begin(), distributions.end(),
+    [](const discrete_distribution& _a, const discrete_distribution& _b)
+    {
+      return _a.probabilities().size() < _b.probabilities().size();
+    });
+  for (const auto& sequence : _sequences)
+  {
+    if (!widest->check_observations(sequence.size(), sequence.data())) { return result; }
+  }
+
+  partition(_sequences);
+
+  double last_log_likelihood = -std::numeric_limits<double>::infinity();
+
+  for (std::uint64_t i = 0; i < _iterations; i++)
+  {
+    MATE_TRACE_SCOPE("baum_welch::iteration");
+    const auto start = std::chrono::steady_clock::now();
+
+    update_emissions();
+
+    const std::uint64_t state_count = m_emissions.rows();
+    const std::uint64_t symbol_count = m_emissions.cols();
+
+    // expectation step, one task per worker
+    for (auto& current : m_workers)
+    {
+      worker* w = &current;
+      m_thread_pool.submit([this, w, &_sequences, state_count, symbol_count]
+      {
+        MATE_TRACE_SCOPE("baum_welch::expectation");
+        w->accumulator.reset(state_count, symbol_count);
+        for (std::uint64_t s = w->begin; s < w->end; s++)
+        {
+          expectation(_sequences[s], *w);
+        }
+      });
+    }
+    m_thread_pool.wait();
+
+    // reduction step
+    statistics& merged = m_workers.front().accumulator;
+    for (std::uint64_t w = 1; w < m_workers.size(); w++)
+    {
+      merged.merge(m_workers[w].accumulator);
+    }
+
+    // maximization step, unless a sequence is impossible under the model and the counts are
+    // incomplete
+    const bool finite = std::isfinite(merged.log_likelihood);
+    if (finite) { maximization(merged); }
+
+    const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+    iteration summary;
+    summary.log_likelihood = merged.log_likelihood;
+    summary.seconds = seconds.count();
+    result.push_back(summary);
+    MATE_TRACE_COUNTER("baum_welch log-likelihood", summary.log_likelihood);
+
+    std::cout << std::setprecision(10) << "baum-welch iteration " << i << " with a log-likelihood of " << summary.log_likelihood << " after " << summary.seconds << " seconds." << std::endl;
+
+    // the difference of two infinite log-likelihoods is not a number and would never converge
+    if (!finite)
+    {
+      std::cout << "baum-welch stopped, the observation sequences are impossible under the model." << std::endl;
+      break;
+    }
+    if (summary.log_likelihood - last_log_likelihood <= _epsilon) { break; }
+    last_log_likelihood = summary.log_likelihood;
+  }
+
+  return result;
+}
+
+// -------------------------------------------------------------------------------------------------
+// private
+// -------------------------------------------------------------------------------------------------
+
+void baum_welch::statistics::reset(const std::uint64_t _state_count, const std::uint64_t _symbol_count)
+{
+  initial.setZero(_state_count);
+  transitions.setZero(_state_count, _state_count);
+  emissions.setZero(_symbol_count, _state_count);
+  log_likelihood = 0;
+}
+
+void baum_welch::statistics::merge(const statistics& _statistics)
+{
+  initial += _statistics.initial;
+  transitions += _statistics.transitions;
+  emissions += _statistics.emissions;
+  log_likelihood += _statistics.log_likelihood;
+}
+
+void baum_welch::expectation(const std::vector<std::uint64_t>& _sequence, worker& _worker) const
+{
+  const std::uint64_t length = _sequence.size();
+  if (length == 0) { return; }
+
+  const std::uint64_t state_count = m_emissions.rows();
+  const Eigen::MatrixXd& transition_matrix = m_markov_chain.transition_matrix();
+
+  // scratch buffers only ever grow to the longest sequence of this worker
+  if (static_cast<std::uint64_t>(_worker.alpha.rows()) < length)
+  {
+    _worker.alpha.resize(length, state_count);
+    _worker.beta.resize(length, state_count);
+    _worker.scale.resize(length);
+  }
+  auto& alpha = _worker.alpha;
+  auto& beta = _worker.beta;
+  auto& scale = _worker.scale;
+
+  // scaled forward pass
+  alpha.row(0) = m_markov_chain.initial_state().cwiseProduct(m_emissions.col(_sequence[0]).transpose());
+  for (std::uint64_t t = 0; t < length; t++)
+  {
+    if (t > 0)
+    {
+      alpha.row(t).noalias() = alpha.row(t - 1) * transition_matrix;
+      alpha.row(t).array() *= m_emissions.col(_sequence[t]).transpose().array();
+    }
+
+    scale[t] = alpha.row(t).sum();
+    if (scale[t] <= 0)
+    {
+      // the sequence is impossible under the current model and contributes no counts
+      _worker.accumulator.log_likelihood = -std::numeric_limits<double>::infinity();
+      return;
+    }
+    alpha.row(t) /= scale[t];
+  }
+
+  // scaled backward pass
+  beta.row(length - 1).setOnes();
+  for (std::uint64_t t = length - 1; t > 0; t--)
+  {
+    beta.row(t - 1).noalias() =
+      (beta.row(t).cwiseProduct(m_emissions.col(_sequence[t]).transpose()) / scale[t])
+      * transition_matrix.transpose();
+  }
+
+  // expected initial state and emission counts
+  statistics& accumulator = _worker.accumulator;
+  accumulator.initial += alpha.row(0).cwiseProduct(beta.row(0));
+  for (std::uint64_t t = 0; t < length; t++)
+  {
+    accumulator.emissions.row(_sequence[t]) += alpha.row(t).cwiseProduct(beta.row(t));
+  }
+
+  // expected transition counts, summed over all time steps by a single matrix product
+  for (std::uint64_t t = 1; t < length; t++)
+  {
+    beta.row(t).array() *= m_emissions.col(_sequence[t]).transpose().array() / scale[t];
+  }
+  accumulator.transitions.noalias() +=
+    alpha.topRows(length - 1).transpose() * beta.middleRows(1, length - 1);
+
+  accumulator.log_likelihood += scale.head(length).array().log().sum();
+}
+
+void baum_welch::maximization(const statistics& _statistics)
+{
+  const std::uint64_t state_count = m_emissions.rows();
+  const std::uint64_t symbol_count = m_emissions.cols();
+
+  // initial state vector
+  const double initial_sum = _statistics.initial.sum();
+  if (initial_sum > 0)
+  {
+    m_markov_chain.initial_state() = _statistics.initial / initial_sum;
+  }
+
+  // transition matrix, rows without any expected transition keep their probabilities
+  Eigen::MatrixXd& transition_matrix = m_markov_chain.transition_matrix();
+  for (std::uint64_t i = 0; i < state_count; i++)
+  {
+    Eigen::RowVectorXd row = transition_matrix.row(i).cwiseProduct(_statistics.transitions.row(i));
+    const double row_sum = row.sum();
+    if (row_sum > 0)
+    {
+      transition_matrix.row(i) = row / row_sum;
+    }
+  }
+
+  // emission distributions, by weighted re-estimation over every possible symbol of each
+  // distribution, the symbols beyond a narrower distribution have no expected emissions
+  const Eigen::MatrixXd symbols = Eigen::RowVectorXd::LinSpaced(symbol_count, 0, static_cast<double>(symbol_count) - 1);
+  std::vector<discrete_distribution>& distributions = m_markov_chain.emission_distributions();
+  for (std::uint64_t j = 0; j < state_count; j++)
+  {
+    const Eigen::MatrixXd::Index size = distributions[j].probabilities().size();
+    distributions[j].estimate(symbols.leftCols(size), _statistics.emissions.col(j).head(size));
+  }
+}
+
+void baum_welch::partition(const std::vector<std::vector<std::uint64_t>>& _sequences)
+{
+  const std::uint64_t worker_count = std::min<std::uint64_t>(m_thread_pool.thread_count(), _sequences.size());
+
+  std::uint64_t total_length = 0;
+  for (const auto& sequence : _sequences)
+  {
+    total_length += sequence.size();
+  }
+
+  m_workers.resize(worker_count);
+
+  std::uint64_t s = 0;
+  std::uint64_t assigned_length = 0;
+  for (std::uint64_t w = 0; w < worker_count; w++)
+  {
+    m_workers[w].begin = s;
+
+    // leave at least one sequence for each of the remaining workers
+    const std::uint64_t target_length = total_length * (w + 1) / worker_count;
+    const std::uint64_t last = _sequences.size() - (worker_count - w - 1);
+    while (s < last && (s == m_workers[w].begin || assigned_length < target_length))
+    {
+      assigned_length += _sequences[s].size();
+      s++;
+    }
+
+    m_workers[w].end = s;
+  }
+  m_workers.back().end = _sequences.size();
+}
+
+void baum_welch::update_emissions()
+{
+  const std::vector<discrete_distribution>& distributions = m_markov_chain.emission_distributions();
+
+  std::uint64_t symbol_count = 0;
+  for (const auto& distribution : distributions)
+  {
+    symbol_count = std::max<std::uint64_t>(symbol_count, distribution.probabilities().size());
+  }
+
+  m_emissions.setZero(distributions.size(), symbol_count);
+  for (std::uint64_t j = 0; j < distributions.size(); j++)
+  {
+    const Eigen::VectorXd& probabilities = distributions[j].probabilities();
+    m_emissions.row(j).head(probabilities.size()) = probabilities.transpose();
+  }
+}
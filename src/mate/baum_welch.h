@@ -0,0 +1,109 @@
+#pragma once
+
+#include "discrete_distribution.h"
+#include "markov_chain.h"
+#include "thread_pool.h"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <vector>
+
+/// Expectation maximization training (Baum-Welch) of a hidden markov model with discrete
+/// emissions. The expectation step of every iteration is spread over the worker threads of a
+/// thread pool. Each worker accumulates the expected initial state, transition and emission counts
+/// of its share of the observation sequences locally, a reduction step merges them before the
+/// maximization step re-estimates the model.
+class baum_welch
+{
+public:
+  /// Summary of a single training iteration.
+  struct iteration
+  {
+    /// Log-likelihood of all observation sequences under the model of this iteration.
+    double log_likelihood;
+    /// Wall-clock time of this iteration in seconds.
+    double seconds;
+  };
+
+  /// Prepare the training of the given markov chain.
+  /// \param _markov_chain Markov chain to train. It is modified in place.
+  /// \param _thread_pool Thread pool to evaluate the expectation step with.
+  baum_welch(markov_chain<discrete_distribution>& _markov_chain, thread_pool& _thread_pool);
+
+  /// Train the markov chain on the given observation sequences until the given number of
+  /// iterations is reached or the log-likelihood improves less than epsilon.
+  /// \param _sequences List of observation sequences. Each observation must be in
+  ///   [0,_symbol_count) of the widest emission distribution, otherwise it is reported and
+  ///   nothing is trained.
+  /// \param _iterations Maximum number of iterations.
+  /// \param _epsilon Threshold for the improvement of the log-likelihood between two iterations.
+  ///   Set epsilon to a negative value to deactivate its break condition.
+  /// \return Summary of each performed iteration. If any sequence is impossible under the model,
+  ///   the training is reported and stopped without re-estimating the model, and the last
+  ///   summary has a log-likelihood of negative infinity.
+  std::vector<iteration> train(
+    const std::vector<std::vector<std::uint64_t>>& _sequences,
+    const std::uint64_t _iterations = 100,
+    const double _epsilon = 1.0e-6
+  );
+
+private:
+  /// Expected counts accumulated by the expectation step.
+  struct statistics
+  {
+    /// Expected number of sequences starting in each state.
+    Eigen::RowVectorXd initial;
+    /// Expected number of transitions between each pair of states, before the element-wise
+    /// multiplication with the transition matrix.
+    Eigen::MatrixXd transitions;
+    /// Expected number of emissions of each symbol (rows) in each state (columns).
+    Eigen::MatrixXd emissions;
+    /// Log-likelihood of all evaluated observation sequences.
+    double log_likelihood;
+
+    void reset(const std::uint64_t _state_count, const std::uint64_t _symbol_count);
+    void merge(const statistics& _statistics);
+  };
+
+  /// Per-worker state of the expectation step.
+  struct worker
+  {
+    /// Sequences [begin,end) evaluated by this worker.
+    std::uint64_t begin;
+    std::uint64_t end;
+    statistics accumulator;
+    /// Scaled forward variables, one row per observation.
+    Eigen::MatrixXd alpha;
+    /// Scaled backward variables, one row per observation.
+    Eigen::MatrixXd beta;
+    /// Scaling factors of the forward variables.
+    Eigen::VectorXd scale;
+  };
+
+  /// Evaluate the forward-backward algorithm on a single observation sequence and add its
+  /// expected counts to the worker's accumulator.
+  /// \param _sequence observation sequence.
+  /// \param _worker worker to accumulate into.
+  void expectation(const std::vector<std::uint64_t>& _sequence, worker& _worker) const;
+
+  /// Re-estimate the markov chain from the merged expected counts.
+  /// \param _statistics merged expected counts of all sequences.
+  void maximization(const statistics& _statistics);
+
+  /// Assign contiguous ranges of sequences of roughly equal total length to the workers.
+  /// \param _sequences List of observation sequences.
+  void partition(const std::vector<std::vector<std::uint64_t>>& _sequences);
+
+  /// Update the emission matrix from the emission distributions of the markov chain.
+  void update_emissions();
+
+  markov_chain<discrete_distribution>& m_markov_chain;
+
+  /// Emission probability of each state (rows) for each symbol (columns) in the current
+  /// iteration. The column of a symbol is contiguous in memory.
+  Eigen::MatrixXd m_emissions;
+
+  thread_pool& m_thread_pool;
+  std::vector<worker> m_workers;
+};
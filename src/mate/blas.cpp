@@ -0,0 +1,47 @@
+#include "blas.h"
+
+#include <Eigen/Core>
+
+#include <thread>
+
+#ifdef MATE_USE_OPENBLAS
+extern "C" {
+  void openblas_set_num_threads(int num_threads);
+  int openblas_get_num_threads(void);
+}
+#endif
+
+namespace math {
+
+bool blas_enabled()
+{
+#ifdef MATE_USE_OPENBLAS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void set_blas_threads(const std::uint64_t _thread_count)
+{
+  int thread_count = static_cast<int>(_thread_count);
+  if (thread_count == 0) { thread_count = static_cast<int>(std::thread::hardware_concurrency()); }
+  if (thread_count == 0) { thread_count = 1; }
+
+#ifdef MATE_USE_OPENBLAS
+  openblas_set_num_threads(thread_count);
+#else
+  Eigen::setNbThreads(thread_count);
+#endif
+}
+
+std::uint64_t blas_threads()
+{
+#ifdef MATE_USE_OPENBLAS
+  return openblas_get_num_threads();
+#else
+  return Eigen::nbThreads();
+#endif
+}
+
+}; // namespace math
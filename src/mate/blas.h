@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+namespace math {
+
+/// \return whether Eigen routes its dense products & decompositions through OpenBLAS, i.e. the
+///   build option CONFIG_USE_OPENBLAS.
+bool blas_enabled();
+
+/// Set the number of threads used by dense products. Affects OpenBLAS if enabled, otherwise the
+/// parallelization of Eigen itself (requires OpenMP).
+/// \param _thread_count number of threads. Zero selects the number of hardware threads.
+void set_blas_threads(const std::uint64_t _thread_count);
+
+/// \return the number of threads used by dense products.
+std::uint64_t blas_threads();
+
+}; // namespace math
@@ -0,0 +1,69 @@
+#include "discrete_accumulator.h"
+
+#include <algorithm>
+#include <iostream>
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+discrete_accumulator::discrete_accumulator(const std::uint64_t _observation_count)
+  : m_counts(_observation_count, 0)
+  , m_weights(Eigen::VectorXd::Zero(_observation_count))
+  , m_rejected(0)
+{
+  /* empty */
+}
+
+void discrete_accumulator::add(const std::uint64_t _count, const std::uint64_t* _observations)
+{
+  for (std::uint64_t i = 0; i < _count; i++)
+  {
+    add(_observations[i]);
+  }
+}
+
+void discrete_accumulator::add(
+  const std::uint64_t _count,
+  const std::uint64_t* _observations,
+  const double* _weights)
+{
+  for (std::uint64_t i = 0; i < _count; i++)
+  {
+    add(_observations[i], _weights[i]);
+  }
+}
+
+bool discrete_accumulator::merge(const discrete_accumulator& _accumulator)
+{
+  if (_accumulator.m_counts.size() != m_counts.size())
+  {
+    std::cout << "Accumulator of " << _accumulator.m_counts.size() << " observations cannot be merged into an accumulator of " << m_counts.size() << " observations." << std::endl;
+    return false;
+  }
+
+  for (std::uint64_t i = 0; i < m_counts.size(); i++)
+  {
+    m_counts[i] += _accumulator.m_counts[i];
+  }
+  m_weights += _accumulator.m_weights;
+  m_rejected += _accumulator.m_rejected;
+  return true;
+}
+
+void discrete_accumulator::clear()
+{
+  std::fill(m_counts.begin(), m_counts.end(), 0);
+  m_weights.setZero();
+  m_rejected = 0;
+}
+
+Eigen::VectorXd discrete_accumulator::occurrences() const
+{
+  Eigen::VectorXd result = m_weights;
+  for (std::uint64_t i = 0; i < m_counts.size(); i++)
+  {
+    result[i] += static_cast<double>(m_counts[i]);
+  }
+  return result;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <vector>
+
+/// Sufficient statistics of a discrete_distribution: the number of occurrences of each possible
+/// observation. Observations are added one at a time or in batches from a stream of any length in
+/// constant memory. Accumulators filled on different threads can be merged, and the result is
+/// committed into a distribution with discrete_distribution::estimate(const discrete_accumulator&)
+/// whenever an up to date estimate is needed.
+/// Unweighted observations are counted exactly as integers, weighted observations are summed up
+/// separately as doubles.
+class discrete_accumulator
+{
+public:
+  /// Define the accumulator for a distribution with _observation_count possible observations.
+  /// \param _observation_count number of possible observations.
+  discrete_accumulator(const std::uint64_t _observation_count = 1);
+
+  /// \return the number of possible observations.
+  std::uint64_t observation_count() const { return m_counts.size(); }
+
+  /// Add a single observation. Observations out of bounds are rejected.
+  /// \param _observation observation to add.
+  void add(const std::uint64_t _observation)
+  {
+    if (_observation < m_counts.size()) { m_counts[_observation]++; } else { m_rejected++; }
+  }
+
+  /// Add a single, weighted observation. Observations out of bounds are rejected.
+  /// \param _observation observation to add.
+  /// \param _weight probability that the observation is actually from the distribution.
+  void add(const std::uint64_t _observation, const double _weight)
+  {
+    if (_observation < m_counts.size()) { m_weights[_observation] += _weight; } else { m_rejected++; }
+  }
+
+  /// Add a batch of observations. Observations out of bounds are rejected.
+  /// \param _count number of observations.
+  /// \param _observations contiguous array of observations.
+  void add(const std::uint64_t _count, const std::uint64_t* _observations);
+
+  /// Add a batch of weighted observations. Observations out of bounds are rejected.
+  /// \param _count number of observations.
+  /// \param _observations contiguous array of observations.
+  /// \param _weights probability that each observation is actually from the distribution.
+  void add(const std::uint64_t _count, const std::uint64_t* _observations, const double* _weights);
+
+  /// Add the statistics of another accumulator of the same number of possible observations. An
+  /// accumulator of a different number is rejected and leaves this one unchanged.
+  /// \param _accumulator accumulator to merge into this one.
+  /// \return whether the accumulator has been merged.
+  bool merge(const discrete_accumulator& _accumulator);
+
+  /// Remove all observations.
+  void clear();
+
+  /// \return the number of unweighted occurrences of each possible observation.
+  const std::vector<std::uint64_t>& counts() const { return m_counts; }
+
+  /// \return the summed weight of the weighted occurrences of each possible observation.
+  const Eigen::VectorXd& weights() const { return m_weights; }
+
+  /// \return the total, weighted and unweighted occurrences of each possible observation.
+  Eigen::VectorXd occurrences() const;
+
+  /// \return the number of observations rejected for being out of bounds.
+  std::uint64_t rejected() const { return m_rejected; }
+
+private:
+  /// Unweighted occurrences of each possible observation.
+  std::vector<std::uint64_t> m_counts;
+
+  /// Weighted occurrences of each possible observation.
+  Eigen::VectorXd m_weights;
+
+  /// Number of observations out of bounds.
+  std::uint64_t m_rejected;
+};
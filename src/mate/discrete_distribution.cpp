@@ -1,6 +1,9 @@
 #include "discrete_distribution.h"
+#include "discrete_accumulator.h"
 #include "random.h"
+#include "trace.h"
 
+#include <algorithm>
 #include <iostream>
 
 // -------------------------------------------------------------------------------------------------
@@ -9,11 +12,13 @@
 
 discrete_distribution::discrete_distribution(const std::uint64_t _observation_count)
   : m_probabilities(Eigen::VectorXd::Ones(_observation_count) / static_cast<double>(_observation_count))
+  , m_outdated(true)
 {
   /* empty */
 }
 
 discrete_distribution::discrete_distribution(const Eigen::VectorXd& _probabilities)
+  : m_outdated(true)
 {
   // make sure the probability distribution is normalized
   double sum = _probabilities.sum();
@@ -29,6 +34,23 @@ discrete_distribution::discrete_distribution(const Eigen::VectorXd& _probabiliti
   }
 }
 
+discrete_distribution::discrete_distribution(const discrete_distribution& _discrete_distribution)
+  : m_probabilities(_discrete_distribution.m_probabilities)
+  , m_outdated(true)
+{
+  /* empty */
+}
+
+discrete_distribution& discrete_distribution::operator=(const discrete_distribution& _discrete_distribution)
+{
+  if (this != &_discrete_distribution)
+  {
+    m_probabilities = _discrete_distribution.m_probabilities;
+    m_outdated = true;
+  }
+  return *this;
+}
+
 double discrete_distribution::probability(const Eigen::VectorXd& _observation) const
 {
   const std::uint64_t obs = static_cast<std::uint64_t>(_observation[0]);
@@ -38,26 +60,108 @@ double discrete_distribution::probability(const Eigen::VectorXd& _observation) c
   return m_probabilities(obs);
 }
 
+double discrete_distribution::log_probability(const Eigen::VectorXd& _observation) const
+{
+  const std::uint64_t obs = static_cast<std::uint64_t>(_observation[0]);
+
+  check_observation(obs);
+
+  update();
+
+  return m_log_probabilities(obs);
+}
+
+bool discrete_distribution::probability(
+  const std::uint64_t _count,
+  const std::uint64_t* _observations,
+  double* _probabilities) const
+{
+  if (!check_observations(_count, _observations)) { return false; }
+
+  const double* probabilities = m_probabilities.data();
+  for (std::uint64_t i = 0; i < _count; i++)
+  {
+    _probabilities[i] = probabilities[_observations[i]];
+  }
+
+  return true;
+}
+
+bool discrete_distribution::log_probability(
+  const std::uint64_t _count,
+  const std::uint64_t* _observations,
+  double* _log_probabilities) const
+{
+  if (!check_observations(_count, _observations)) { return false; }
+
+  update();
+
+  const double* log_probabilities = m_log_probabilities.data();
+  for (std::uint64_t i = 0; i < _count; i++)
+  {
+    _log_probabilities[i] = log_probabilities[_observations[i]];
+  }
+
+  return true;
+}
+
 Eigen::VectorXd discrete_distribution::random() const
 {
+  update();
+
   // generate a random, uniformly distributed number
-  double random_observation = math::random();
   Eigen::VectorXd result(1);
+  result[0] = static_cast<double>(draw(math::random()));
+  return result;
+}
 
-  double sum_probability = 0;
-  std::uint64_t max = m_probabilities.size();
-  for (std::uint64_t observation = 0; observation < max; observation++)
+Eigen::VectorXd discrete_distribution::random(math::random_stream& _stream) const
+{
+  update();
+
+  Eigen::VectorXd result(1);
+  result[0] = static_cast<double>(draw(_stream.random()));
+  return result;
+}
+
+void discrete_distribution::sample(const std::uint64_t _count, std::uint64_t* _observations) const
+{
+  update();
+
+  // uniformly distributed numbers are generated in bulk, chunk by chunk on the stack
+  const std::uint64_t chunk = 256;
+  double random_numbers[chunk];
+
+  for (std::uint64_t i = 0; i < _count; i += chunk)
   {
-    if ((sum_probability += m_probabilities[observation]) >= random_observation)
+    const std::uint64_t n = std::min(chunk, _count - i);
+    math::fill_uniform(Eigen::Map<Eigen::VectorXd>(random_numbers, n));
+    for (std::uint64_t j = 0; j < n; j++)
     {
-      result[0] = static_cast<double>(observation);
-      return result;
+      _observations[i + j] = draw(random_numbers[j]);
     }
   }
+}
 
-  // this should never happen
-  result[0] = static_cast<double>(max) - 1;
-  return result;
+void discrete_distribution::sample(
+  const std::uint64_t _count,
+  std::uint64_t* _observations,
+  math::random_stream& _stream) const
+{
+  update();
+
+  const std::uint64_t chunk = 256;
+  double random_numbers[chunk];
+
+  for (std::uint64_t i = 0; i < _count; i += chunk)
+  {
+    const std::uint64_t n = std::min(chunk, _count - i);
+    _stream.fill_uniform(Eigen::Map<Eigen::VectorXd>(random_numbers, n));
+    for (std::uint64_t j = 0; j < n; j++)
+    {
+      _observations[i + j] = draw(random_numbers[j]);
+    }
+  }
 }
 
 void discrete_distribution::estimate(const Eigen::MatrixXd& _observations)
@@ -100,10 +204,79 @@ void discrete_distribution::estimate(
   normalize();
 }
 
+bool discrete_distribution::estimate(const discrete_accumulator& _accumulator)
+{
+  if (_accumulator.observation_count() != static_cast<std::uint64_t>(m_probabilities.size()))
+  {
+    std::cout << "Accumulator of " << _accumulator.observation_count() << " observations cannot estimate a distribution of " << m_probabilities.size() << " observations." << std::endl;
+    return false;
+  }
+
+  m_probabilities = _accumulator.occurrences();
+
+  normalize();
+  return true;
+}
+
+void discrete_distribution::set_probabilities(const Eigen::VectorXd& _probabilities)
+{
+  m_probabilities = _probabilities;
+
+  // invalidated only after the write, so that a concurrent rebuild cannot adopt an outdated vector
+  m_outdated = true;
+}
+
 // -------------------------------------------------------------------------------------------------
 // private
 // -------------------------------------------------------------------------------------------------
 
+void discrete_distribution::update() const
+{
+  if (!m_outdated.load(std::memory_order_acquire)) { return; }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_outdated.load(std::memory_order_relaxed)) { return; } // rebuilt by another thread
+
+  MATE_TRACE_SCOPE("discrete_distribution::update");
+
+  // Vose's alias method: columns of below average probability are filled up by an alias of above
+  // average probability, until every column holds exactly the average probability
+  const std::uint64_t count = m_probabilities.size();
+  m_alias_probabilities = m_probabilities * static_cast<double>(count);
+  m_aliases.resize(count);
+
+  std::vector<std::uint64_t> small;
+  std::vector<std::uint64_t> large;
+  for (std::uint64_t i = 0; i < count; i++)
+  {
+    m_aliases[i] = i;
+    if (m_alias_probabilities[i] < 1) { small.push_back(i); } else { large.push_back(i); }
+  }
+
+  while (!small.empty() && !large.empty())
+  {
+    const std::uint64_t less = small.back();
+    const std::uint64_t more = large.back();
+    small.pop_back();
+
+    m_aliases[less] = more;
+    m_alias_probabilities[more] -= 1 - m_alias_probabilities[less];
+    if (m_alias_probabilities[more] < 1)
+    {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
+
+  // leftovers only differ from one by rounding errors
+  for (auto i : small) { m_alias_probabilities[i] = 1; }
+  for (auto i : large) { m_alias_probabilities[i] = 1; }
+
+  m_log_probabilities = m_probabilities.array().log();
+
+  m_outdated.store(false, std::memory_order_release);
+}
+
 void discrete_distribution::normalize()
 {
   // make sure the probability distribution is normalized
@@ -117,6 +290,8 @@ void discrete_distribution::normalize()
     // force normalization
     m_probabilities.fill(1 / static_cast<double>(m_probabilities.size()));
   }
+
+  m_outdated = true;
 }
 
 void discrete_distribution::check_observation(
@@ -137,6 +312,24 @@ void discrete_distribution::check_observation(
   }
 }
 
+bool discrete_distribution::check_observations(
+  const std::uint64_t _count,
+  const std::uint64_t* _observations) const
+{
+  // a branch-free maximum over the whole batch, the offending index is only searched on failure
+  std::uint64_t max = 0;
+  for (std::uint64_t i = 0; i < _count; i++)
+  {
+    max = std::max(max, _observations[i]);
+  }
+
+  if (_count == 0 || max < static_cast<std::uint64_t>(m_probabilities.size())) { return true; }
+
+  const std::uint64_t index = std::find(_observations, _observations + _count, max) - _observations;
+  check_observation(max, index);
+  return false;
+}
+
 // -------------------------------------------------------------------------------------------------
 // friend
 // -------------------------------------------------------------------------------------------------
@@ -2,8 +2,15 @@
 
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <iosfwd>
+#include <mutex>
+#include <vector>
+
+class discrete_accumulator;
+namespace math { class random_stream; }
 
 /// A discrete probability distribution where the only observations are discrete observations.
 /// Useful with Hidden Markov Models, where observations are non-negative integers representing
@@ -13,6 +20,9 @@
 /// \note While a discrete distribution only has positive integers (uint64_t) as observations they
 ///   can be converted to doubles, which is in internal use. The distribution will convert doubles
 ///   back into uint64_t before any kind of comparison.
+/// \note Random observations are drawn in constant time from an alias table (Walker, Vose). The
+///   alias table and the log-probabilities are rebuilt lazily on their first use after the
+///   probabilities changed. Drawing is safe from multiple threads at once.
 class discrete_distribution
 {
 public:
@@ -25,6 +35,9 @@ public:
   /// \param _probabilities probability of each possible observation.
   discrete_distribution(const Eigen::VectorXd& _probabilities);
 
+  discrete_distribution(const discrete_distribution& _discrete_distribution);
+  discrete_distribution& operator=(const discrete_distribution& _discrete_distribution);
+
   /// Get the dimensionality of the probability distribution. As the probability distribution is a
   /// simple vector it will always be 1.
   /// \return dimensionality of the probability distribution.
@@ -36,11 +49,67 @@ public:
   /// \return probability of the given observation.
   double probability(const Eigen::VectorXd& _observation) const;
 
+  /// Return the natural logarithm of the probability of the given observation. It should not be
+  /// greater than the number of possible observations.
+  /// \param _observation observation to return the log-probability of.
+  /// \return log-probability of the given observation.
+  double log_probability(const Eigen::VectorXd& _observation) const;
+
+  /// Gather the probability of each of the given observations. The observations are validated
+  /// once for the whole batch, nothing is written if any of them is out of bounds.
+  /// \param _count number of observations.
+  /// \param _observations contiguous array of observations.
+  /// \param _probabilities preallocated destination of the probability of each observation.
+  /// \return whether every observation is within the bounds of this distribution.
+  bool probability(
+    const std::uint64_t _count,
+    const std::uint64_t* _observations,
+    double* _probabilities
+  ) const;
+
+  /// Gather the natural logarithm of the probability of each of the given observations. The
+  /// observations are validated once for the whole batch, nothing is written if any of them is
+  /// out of bounds.
+  /// \param _count number of observations.
+  /// \param _observations contiguous array of observations.
+  /// \param _log_probabilities preallocated destination of the log-probability of each
+  ///   observation.
+  /// \return whether every observation is within the bounds of this distribution.
+  bool log_probability(
+    const std::uint64_t _count,
+    const std::uint64_t* _observations,
+    double* _log_probabilities
+  ) const;
+
   /// Return a single, randomly generated observation as a single element of a one-dimensional
   /// vector, according to the probability distribution defined by this object.
   /// \return a random observation.
   Eigen::VectorXd random() const;
 
+  /// Return a single, randomly generated observation as a single element of a one-dimensional
+  /// vector, according to the probability distribution defined by this object. The random number
+  /// is drawn from the given stream, which makes concurrent sampling safe.
+  /// \param _stream stream of random numbers to draw from.
+  /// \return a random observation.
+  Eigen::VectorXd random(math::random_stream& _stream) const;
+
+  /// Generate the given number of random observations according to the probability distribution
+  /// defined by this object.
+  /// \param _count number of observations to generate.
+  /// \param _observations preallocated destination of at least _count observations.
+  void sample(const std::uint64_t _count, std::uint64_t* _observations) const;
+
+  /// Generate the given number of random observations according to the probability distribution
+  /// defined by this object. The random numbers are drawn from the given stream.
+  /// \param _count number of observations to generate.
+  /// \param _observations preallocated destination of at least _count observations.
+  /// \param _stream stream of random numbers to draw from.
+  void sample(
+    const std::uint64_t _count,
+    std::uint64_t* _observations,
+    math::random_stream& _stream
+  ) const;
+
   /// Estimate the probability distribution directly from the given observations. It should not be
   /// greater than the number of possible observations.
   /// \param _observations list of observations.
@@ -57,12 +126,30 @@ public:
     const Eigen::VectorXd& _probabilities
   );
 
+  /// Estimate the probability distribution from the occurrences collected by an accumulator of the
+  /// same number of possible observations. An accumulator of a different number is rejected and
+  /// leaves the distribution unchanged.
+  /// \param _accumulator statistics of the observations.
+  /// \return whether the distribution has been estimated.
+  bool estimate(const discrete_accumulator& _accumulator);
+
+  /// Ensure that all observations of a batch are within the bounds of this distribution. The
+  /// first offending observation is reported.
+  /// \param _count number of observations.
+  /// \param _observations contiguous array of observations.
+  /// \return whether every observation is within the bounds.
+  bool check_observations(const std::uint64_t _count, const std::uint64_t* _observations) const;
+
   /// \return the vector of probabilities.
   const Eigen::VectorXd& probabilities() const { return m_probabilities; }
 
-  /// Modify the vector of probabilities.
-  /// \return reference to the vector of probabilities.
-  Eigen::VectorXd& probabilities() { return m_probabilities; }
+  /// \return the natural logarithm of the vector of probabilities, rebuilt first if outdated.
+  const Eigen::VectorXd& log_probabilities() const { update(); return m_log_probabilities; }
+
+  /// Replace the vector of probabilities, which is taken as is. The derived tables are rebuilt on
+  /// their next use.
+  /// \param _probabilities probability of each possible observation.
+  void set_probabilities(const Eigen::VectorXd& _probabilities);
 
   /// Overload of the output operator for easy output (serialization, print, ...).
   /// \return a ostream representation of this distribution.
@@ -75,6 +162,36 @@ private:
   /// Vector of probabilities in this distribution.
   Eigen::VectorXd m_probabilities;
 
+  /// Probability to keep the column of the alias table instead of using its alias.
+  mutable Eigen::VectorXd m_alias_probabilities;
+
+  /// Alias observation of each column of the alias table.
+  mutable std::vector<std::uint64_t> m_aliases;
+
+  /// Natural logarithm of the vector of probabilities.
+  mutable Eigen::VectorXd m_log_probabilities;
+
+  /// Whether the derived tables have to be rebuilt from the vector of probabilities.
+  mutable std::atomic<bool> m_outdated;
+
+  /// Serializes the rebuild of the derived tables.
+  mutable std::mutex m_mutex;
+
+  /// Rebuild the alias table and the log-probabilities if the vector of probabilities changed.
+  void update() const;
+
+  /// Map a uniformly distributed random number onto an observation. The alias table must be up to
+  /// date.
+  /// \param _random_number uniformly distributed number between zero and one.
+  /// \return the observation.
+  std::uint64_t draw(const double _random_number) const
+  {
+    const std::uint64_t count = m_aliases.size();
+    const double scaled = _random_number * static_cast<double>(count);
+    const std::uint64_t column = std::min(static_cast<std::uint64_t>(scaled), count - 1);
+    return (scaled - static_cast<double>(column) < m_alias_probabilities[column]) ? column : m_aliases[column];
+  }
+
   /// Normalize the vector of probabilities of this distribution.
   void normalize();
 
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "discrete_distribution.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/// A hidden markov chain with discrete emissions, whose number of states and symbols is known at
+/// compile time. All vectors and matrices are fixed-size Eigen types living on the stack, which
+/// lets Eigen unroll the kernels of small chains completely, e.g. the 2x2 product of a machine
+/// alternating between two states. Nothing is allocated after construction.
+/// The constructor accepts the same arguments as markov_chain, so a chain of known size can be
+/// swapped in at compile time.
+/// \tparam state_count Number of states.
+/// \tparam symbol_count Number of possible observations.
+template<int state_count, int symbol_count>
+class fixed_markov_chain
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef Eigen::Matrix<double, 1, state_count> state_vector;
+  typedef Eigen::Matrix<double, state_count, state_count> transition_matrix_type;
+  typedef Eigen::Matrix<double, symbol_count, state_count, (state_count == 1) ? Eigen::ColMajor : Eigen::RowMajor> emission_matrix_type;
+
+  /// Constructor of a markov chain with the given initial state vector, transition matrix and
+  /// emission matrix.
+  /// \param _initial_state Vector of initial state probabilities.
+  /// \param _transition_matrix Matrix of transition probabilities.
+  /// \param _emission_matrix Emission probability of each symbol (rows) in each state (columns).
+  fixed_markov_chain(
+    const state_vector& _initial_state,
+    const transition_matrix_type& _transition_matrix,
+    const emission_matrix_type& _emission_matrix
+  );
+
+  /// Constructor of a markov chain from dynamically sized arguments, as taken by markov_chain.
+  /// The arguments have to match the compile time dimensions, which is asserted. Distributions of
+  /// fewer symbols than symbol_count are padded with zero probabilities.
+  /// \param _initial_state Vector of initial state probabilities.
+  /// \param _transition_matrix Matrix of transition probabilities.
+  /// \param _emission_distributions Vector of emission probability distributions. One for each
+  ///   state.
+  fixed_markov_chain(
+    const Eigen::RowVectorXd& _initial_state,
+    const Eigen::MatrixXd& _transition_matrix,
+    const std::vector<discrete_distribution>& _emission_distributions
+  );
+
+  /// Conversion of the generator matrix of a continuous time markov chain (CTMC) with the given
+  /// time step into a discrete transition matrix.
+  /// \param _generator_matrix Matrix of expected values for a CTMC.
+  /// \param _delta_t Size of a single, discrete time step.
+  static transition_matrix_type from_ctmc(const transition_matrix_type& _generator_matrix, const double _delta_t)
+  {
+    return transition_matrix_type::Identity() + _delta_t * _generator_matrix;
+  }
+
+  /// Estimate the state vector after the specified number of steps or if the rate of change
+  /// threshold requirements are met. Uses the basic, iterative algorithm.
+  /// \param _steps Number of steps to evaluate.
+  /// \param _epsilon Threshold for the rate of change of the state vector between each step,
+  ///   measured in euclidean distance. Set epsilon to a negative value to deactivate its break
+  ///   condition.
+  /// \return the estimated state vector.
+  state_vector estimate(
+    const std::uint64_t _steps = std::numeric_limits<uint64_t>::max(),
+    const double _epsilon = 0
+  ) const;
+
+  /// Estimate the state vector after the specified number of steps or if the rate of change
+  /// threshold requirements are met. Uses the power method.
+  /// \param _steps Number of squarings to evaluate.
+  /// \param _epsilon Threshold for the rate of change of the state vector between each step,
+  ///   measured in euclidean distance. Set epsilon to a negative value to deactivate its break
+  ///   condition.
+  /// \return the estimated state vector.
+  state_vector estimate_power(
+    const std::uint64_t _steps = std::numeric_limits<uint64_t>::max(),
+    const double _epsilon = 1.0e-8
+  ) const;
+
+  /// Compute the log-likelihood of the observation sequence by the scaled forward algorithm.
+  /// \param _count Number of observations.
+  /// \param _sequence Contiguous array of observations.
+  /// \return natural logarithm of the probability of the observation sequence.
+  double log_likelihood(const std::uint64_t _count, const std::uint64_t* _sequence) const;
+
+  /// \return the initial state vector.
+  const state_vector& initial_state() const { return m_initial_state; }
+
+  /// \return the transition probability matrix.
+  const transition_matrix_type& transition_matrix() const { return m_transition_matrix; }
+
+  /// \return the emission probability of each symbol (rows) in each state (columns).
+  const emission_matrix_type& emission_matrix() const { return m_emission_matrix; }
+
+private:
+  /// Initial state vector.
+  state_vector m_initial_state;
+
+  /// Transition probability matrix.
+  transition_matrix_type m_transition_matrix;
+
+  /// Emission probability of each symbol (rows) in each state (columns).
+  emission_matrix_type m_emission_matrix;
+};
+
+// -------------------------------------------------------------------------------------------------
+// implementation
+// -------------------------------------------------------------------------------------------------
+
+template<int state_count, int symbol_count>
+fixed_markov_chain<state_count, symbol_count>::fixed_markov_chain(
+  const state_vector& _initial_state,
+  const transition_matrix_type& _transition_matrix,
+  const emission_matrix_type& _emission_matrix
+) : m_initial_state(_initial_state)
+  , m_transition_matrix(_transition_matrix)
+  , m_emission_matrix(_emission_matrix)
+{
+  /* empty */
+}
+
+template<int state_count, int symbol_count>
+fixed_markov_chain<state_count, symbol_count>::fixed_markov_chain(
+  const Eigen::RowVectorXd& _initial_state,
+  const Eigen::MatrixXd& _transition_matrix,
+  const std::vector<discrete_distribution>& _emission_distributions
+) : m_initial_state(state_vector::Zero())
+  , m_transition_matrix(transition_matrix_type::Zero())
+  , m_emission_matrix(emission_matrix_type::Zero())
+{
+  eigen_assert(_initial_state.size() == state_count && "initial state vector does not match state_count");
+  eigen_assert(_transition_matrix.rows() == state_count && _transition_matrix.cols() == state_count && "transition matrix does not match state_count");
+  eigen_assert(static_cast<int>(_emission_distributions.size()) == state_count && "one emission distribution per state is required");
+
+  m_initial_state = _initial_state;
+  m_transition_matrix = _transition_matrix;
+  for (int j = 0; j < state_count; j++)
+  {
+    const Eigen::VectorXd& probabilities = _emission_distributions[j].probabilities();
+    eigen_assert(probabilities.size() <= symbol_count && "emission distribution exceeds symbol_count");
+    const int count = std::min<int>(symbol_count, static_cast<int>(probabilities.size()));
+    m_emission_matrix.col(j).head(count) = probabilities.head(count);
+  }
+}
+
+template<int state_count, int symbol_count>
+typename fixed_markov_chain<state_count, symbol_count>::state_vector
+fixed_markov_chain<state_count, symbol_count>::estimate(const std::uint64_t _steps, const double _epsilon) const
+{
+  state_vector current = m_initial_state;
+  state_vector next;
+
+  for (std::uint64_t i = 0; i < _steps; i++)
+  {
+    next.noalias() = current * m_transition_matrix;
+    const double distance = (next - current).norm();
+    current = next;
+
+    if (distance <= _epsilon) { break; }
+  }
+
+  return current;
+}
+
+template<int state_count, int symbol_count>
+typename fixed_markov_chain<state_count, symbol_count>::state_vector
+fixed_markov_chain<state_count, symbol_count>::estimate_power(const std::uint64_t _steps, const double _epsilon) const
+{
+  transition_matrix_type current = m_transition_matrix;
+  transition_matrix_type next;
+
+  for (std::uint64_t i = 0; i < _steps; i++)
+  {
+    next.noalias() = current * current;
+    const double distance = (next.row(0) - current.row(0)).norm();
+    current = next;
+
+    if (distance <= _epsilon) { break; }
+  }
+
+  return current.row(0);
+}
+
+template<int state_count, int symbol_count>
+double fixed_markov_chain<state_count, symbol_count>::log_likelihood(
+  const std::uint64_t _count,
+  const std::uint64_t* _sequence) const
+{
+  state_vector alpha = m_initial_state;
+  state_vector next;
+
+  double result = 0;
+  for (std::uint64_t t = 0; t < _count; t++)
+  {
+    if (t > 0)
+    {
+      next.noalias() = alpha * m_transition_matrix;
+      alpha = next;
+    }
+    alpha.array() *= m_emission_matrix.row(_sequence[t]).array();
+
+    const double scale = alpha.sum();
+    if (scale <= 0) { return -std::numeric_limits<double>::infinity(); }
+    alpha /= scale;
+    result += std::log(scale);
+  }
+
+  return result;
+}
@@ -0,0 +1,76 @@
+#include "hazard_rate.h"
+
+#include <cmath>
+
+namespace hazard_rate {
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+}; // namespace
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+double weibull(const double _x, const double _alpha, const double _beta, const double _x0)
+{
+  return _beta / _alpha * std::pow((_x - _x0) / _alpha, _beta - 1);
+}
+
+double deterministic(const double _x, const double _d, const double _delta_t)
+{
+  return (std::fabs(_x - _d) < _delta_t / 2) ? 1.0 / _delta_t : 0.0;
+}
+
+double uniform(const double _x, const double _a, const double _b)
+{
+  return (_x >= _a && _x < _b) ? 1.0 / (_b - _x) : 0.0;
+}
+
+double exponential(const double /*_x*/, const double _lambda)
+{
+  return _lambda;
+}
+
+double normal_pdf(const double _x, const double _mu, const double _sigma)
+{
+  const double z = (_x - _mu) / _sigma;
+  return std::exp(-z * z / 2) / (std::sqrt(2 * pi) * _sigma);
+}
+
+double normal_cdf(const double _x, const double _mu, const double _sigma)
+{
+  // the proxel solver evaluates the incomplete gamma function, erfc is exact to double precision
+  return 0.5 * std::erfc(-(_x - _mu) / (_sigma * std::sqrt(2.0)));
+}
+
+double normal(const double _x, const double _mu, const double _sigma)
+{
+  return normal_pdf(_x, _mu, _sigma) / (1 - normal_cdf(_x, _mu, _sigma));
+}
+
+double lognormal_pdf(const double _x, const double _mu, const double _sigma)
+{
+  if (_x <= 0) { return 0; }
+
+  const double z = (std::log(_x) - _mu) / _sigma;
+  return std::exp(-z * z / 2) / (_x * std::sqrt(2 * pi) * _sigma);
+}
+
+double lognormal_cdf(const double _x, const double _mu, const double _sigma)
+{
+  if (_x <= 0) { return 0; }
+
+  return normal_cdf(std::log(_x), _mu, _sigma);
+}
+
+double lognormal(const double _x, const double _mu, const double _sigma)
+{
+  if (_x == 0.0 || _x > 70000) { return 0.0; }
+
+  return lognormal_pdf(_x, _mu, _sigma) / (1.0 - lognormal_cdf(_x, _mu, _sigma));
+}
+
+}; // namespace hazard_rate
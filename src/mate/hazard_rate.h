@@ -0,0 +1,69 @@
+#pragma once
+
+/// Hazard rate functions (instantaneous rate functions) of common lifetime distributions, ported
+/// from the proxel solver, together with their density and cumulative distribution functions.
+/// hrf = hazard rate function, pdf = probability density function, cdf = cumulative distribution
+/// function.
+namespace hazard_rate {
+
+/// \return the hazard rate of a weibull distribution.
+/// \param _x age.
+/// \param _alpha scale.
+/// \param _beta shape.
+/// \param _x0 location, e.g. a warmup time.
+double weibull(const double _x, const double _alpha, const double _beta, const double _x0 = 0);
+
+/// \return the hazard rate of a deterministic delay, discretized to a single time step.
+/// \param _x age.
+/// \param _d delay.
+/// \param _delta_t size of a single, discrete time step.
+double deterministic(const double _x, const double _d, const double _delta_t);
+
+/// \return the hazard rate of a uniform distribution within [_a,_b).
+/// \param _x age.
+/// \param _a minimum.
+/// \param _b maximum.
+double uniform(const double _x, const double _a, const double _b);
+
+/// \return the hazard rate of an exponential distribution, which does not depend on the age.
+/// \param _x age.
+/// \param _lambda rate.
+double exponential(const double _x, const double _lambda);
+
+/// \return the probability density of a normal distribution.
+/// \param _x age.
+/// \param _mu mean.
+/// \param _sigma standard deviation.
+double normal_pdf(const double _x, const double _mu, const double _sigma);
+
+/// \return the cumulative distribution of a normal distribution.
+/// \param _x age.
+/// \param _mu mean.
+/// \param _sigma standard deviation.
+double normal_cdf(const double _x, const double _mu, const double _sigma);
+
+/// \return the hazard rate of a normal distribution.
+/// \param _x age.
+/// \param _mu mean.
+/// \param _sigma standard deviation.
+double normal(const double _x, const double _mu, const double _sigma);
+
+/// \return the probability density of a lognormal distribution.
+/// \param _x age.
+/// \param _mu mean of the logarithm.
+/// \param _sigma standard deviation of the logarithm.
+double lognormal_pdf(const double _x, const double _mu, const double _sigma);
+
+/// \return the cumulative distribution of a lognormal distribution.
+/// \param _x age.
+/// \param _mu mean of the logarithm.
+/// \param _sigma standard deviation of the logarithm.
+double lognormal_cdf(const double _x, const double _mu, const double _sigma);
+
+/// \return the hazard rate of a lognormal distribution.
+/// \param _x age.
+/// \param _mu mean of the logarithm.
+/// \param _sigma standard deviation of the logarithm.
+double lognormal(const double _x, const double _mu, const double _sigma);
+
+}; // namespace hazard_rate
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <limits>
+
+namespace math {
+
+/// Compute the natural logarithm of the sum of the exponentials of the given log-space values
+/// without leaving log-space. The largest value is shifted to zero before exponentiating, so the
+/// sum cannot overflow and its dominant term is exact. Values more than about 745 below the
+/// maximum still flush to zero, which is below the precision of the sum anyway. All exponentials
+/// are computed in one vectorized pass.
+/// \param _log_values values in log-space.
+/// \return log(sum(exp(_log_values))), or negative infinity if all values are negative infinity.
+inline double logsumexp(const Eigen::Ref<const Eigen::RowVectorXd>& _log_values)
+{
+  if (_log_values.size() == 0) { return -std::numeric_limits<double>::infinity(); }
+
+  const double max = _log_values.maxCoeff();
+  if (!std::isfinite(max)) { return max; }
+
+  return max + std::log((_log_values.array() - max).exp().sum());
+}
+
+/// Leave log-space for a product. The values are shifted by their maximum before exponentiating,
+/// so the largest one becomes exactly one. Values more than about 745 below the maximum flush to
+/// zero.
+/// \param _log_values values in log-space.
+/// \param _shifted preallocated destination of exp(_log_values - max).
+/// \return the maximum, which has to be added back by from_shifted(). Negative infinity if all
+///   values are negative infinity, in which case _shifted is left undefined.
+inline double to_shifted(const Eigen::RowVectorXd& _log_values, Eigen::RowVectorXd& _shifted)
+{
+  const double max = _log_values.maxCoeff();
+  if (std::isfinite(max)) { _shifted = (_log_values.array() - max).exp(); }
+  return max;
+}
+
+/// Return to log-space after a product of values shifted by to_shifted().
+/// \param _shifted result of the product.
+/// \param _max maximum returned by to_shifted().
+/// \param _log_values preallocated destination in log-space.
+inline void from_shifted(const Eigen::RowVectorXd& _shifted, const double _max, Eigen::RowVectorXd& _log_values)
+{
+  if (!std::isfinite(_max)) { _log_values.setConstant(_max); return; }
+  _log_values = _shifted.array().log() + _max;
+}
+
+/// Multiply a state vector in log-space with a transition matrix of probabilities, the transition
+/// step of a forward algorithm in log-space. The state vector is shifted and exponentiated once,
+/// which turns the step into an ordinary vector-matrix product (GEMV) instead of a logsumexp for
+/// each destination state.
+/// \param _log_state_vector state vector in log-space.
+/// \param _transition_matrix matrix of transition probabilities.
+/// \param _scratch preallocated storage of the size of the state vector.
+/// \param _log_result preallocated destination, the next state vector in log-space.
+inline void log_product(
+  const Eigen::RowVectorXd& _log_state_vector,
+  const Eigen::MatrixXd& _transition_matrix,
+  Eigen::RowVectorXd& _scratch,
+  Eigen::RowVectorXd& _log_result)
+{
+  const double max = to_shifted(_log_state_vector, _scratch);
+  if (std::isfinite(max)) { _log_result.noalias() = _scratch * _transition_matrix; }
+  from_shifted(_log_result, max, _log_result);
+}
+
+}; // namespace math
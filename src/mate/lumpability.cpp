@@ -0,0 +1,178 @@
+#include "lumpability.h"
+#include "trace.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <utility>
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+lumpability::lumpability(
+  const Eigen::MatrixXd& _transition_matrix,
+  const kind _kind,
+  const std::vector<std::uint64_t>& _initial_partition,
+  const double _tolerance
+) : m_kind(_kind)
+  , m_blocks(_transition_matrix.rows(), 0)
+{
+  MATE_TRACE_SCOPE("lumpability::lumpability");
+
+  if (_initial_partition.size() == m_blocks.size())
+  {
+    m_blocks = _initial_partition;
+  }
+  else if (!_initial_partition.empty())
+  {
+    // the finest partition is lumpable in any case, nothing is lumped
+    std::cout << "Initial partition of " << _initial_partition.size() << " states does not match the " << m_blocks.size() << " states of the transition matrix, no states are lumped." << std::endl;
+    for (std::uint64_t i = 0; i < m_blocks.size(); i++) { m_blocks[i] = i; }
+  }
+  renumber();
+
+  while (refine(_transition_matrix, _tolerance)) { /* empty */ }
+  MATE_TRACE_COUNTER("lumpability blocks", block_count());
+}
+
+std::vector<std::uint64_t> lumpability::label(const Eigen::MatrixXd& _properties, const double _tolerance)
+{
+  std::map<std::vector<std::int64_t>, std::uint64_t> labels;
+  std::vector<std::uint64_t> result(_properties.rows());
+  std::vector<std::int64_t> quantized(_properties.cols());
+  for (std::uint64_t i = 0; i < result.size(); i++)
+  {
+    for (std::uint64_t k = 0; k < quantized.size(); k++)
+    {
+      quantized[k] = static_cast<std::int64_t>(std::llround(_properties(i, k) / _tolerance));
+    }
+    result[i] = labels.insert(std::make_pair(quantized, labels.size())).first->second;
+  }
+  return result;
+}
+
+Eigen::MatrixXd lumpability::aggregate(const Eigen::MatrixXd& _transition_matrix) const
+{
+  const std::uint64_t count = block_count();
+
+  // sum up the columns of each block, then average the rows of each block
+  Eigen::MatrixXd columns = Eigen::MatrixXd::Zero(_transition_matrix.rows(), count);
+  for (std::uint64_t j = 0; j < m_blocks.size(); j++)
+  {
+    columns.col(m_blocks[j]) += _transition_matrix.col(j);
+  }
+
+  Eigen::MatrixXd result = Eigen::MatrixXd::Zero(count, count);
+  for (std::uint64_t i = 0; i < m_blocks.size(); i++)
+  {
+    result.row(m_blocks[i]) += columns.row(i);
+  }
+  for (std::uint64_t b = 0; b < count; b++)
+  {
+    result.row(b) /= static_cast<double>(m_sizes[b]);
+  }
+
+  return result;
+}
+
+Eigen::RowVectorXd lumpability::aggregate(const Eigen::RowVectorXd& _state_vector) const
+{
+  Eigen::RowVectorXd result = Eigen::RowVectorXd::Zero(block_count());
+  for (std::uint64_t i = 0; i < m_blocks.size(); i++)
+  {
+    result[m_blocks[i]] += _state_vector[i];
+  }
+  return result;
+}
+
+Eigen::RowVectorXd lumpability::expand(const Eigen::RowVectorXd& _aggregated_state_vector) const
+{
+  Eigen::RowVectorXd result(m_blocks.size());
+  for (std::uint64_t i = 0; i < m_blocks.size(); i++)
+  {
+    result[i] = _aggregated_state_vector[m_blocks[i]] / static_cast<double>(m_sizes[m_blocks[i]]);
+  }
+  return result;
+}
+
+Eigen::RowVectorXd lumpability::expand(
+  const Eigen::RowVectorXd& _aggregated_state_vector,
+  const Eigen::RowVectorXd& _weights) const
+{
+  const Eigen::RowVectorXd totals = aggregate(_weights);
+
+  Eigen::RowVectorXd result(m_blocks.size());
+  for (std::uint64_t i = 0; i < m_blocks.size(); i++)
+  {
+    const std::uint64_t block = m_blocks[i];
+    result[i] = (totals[block] > 0)
+      ? _aggregated_state_vector[block] * _weights[i] / totals[block]
+      : _aggregated_state_vector[block] / static_cast<double>(m_sizes[block]);
+  }
+  return result;
+}
+
+// -------------------------------------------------------------------------------------------------
+// private
+// -------------------------------------------------------------------------------------------------
+
+bool lumpability::refine(const Eigen::MatrixXd& _transition_matrix, const double _tolerance)
+{
+  const std::uint64_t state_count = m_blocks.size();
+  const std::uint64_t count = block_count();
+
+  // probability of each state (rows) to move into (ordinary) or to be reached from (exact) each
+  // block (columns)
+  Eigen::MatrixXd signatures = Eigen::MatrixXd::Zero(state_count, count);
+  for (std::uint64_t k = 0; k < state_count; k++)
+  {
+    if (m_kind == kind::ordinary)
+    {
+      signatures.col(m_blocks[k]) += _transition_matrix.col(k);
+    }
+    else
+    {
+      signatures.col(m_blocks[k]) += _transition_matrix.row(k).transpose();
+    }
+  }
+
+  // states stay together if they share their block and their quantized signature
+  typedef std::pair<std::uint64_t, std::vector<std::int64_t>> key;
+  std::map<key, std::uint64_t> splits;
+  std::vector<std::uint64_t> blocks(state_count);
+  for (std::uint64_t i = 0; i < state_count; i++)
+  {
+    key signature(m_blocks[i], std::vector<std::int64_t>(count));
+    for (std::uint64_t b = 0; b < count; b++)
+    {
+      signature.second[b] = static_cast<std::int64_t>(std::llround(signatures(i, b) / _tolerance));
+    }
+    blocks[i] = splits.insert(std::make_pair(signature, splits.size())).first->second;
+  }
+
+  if (splits.size() == count) { return false; }
+
+  m_blocks.swap(blocks);
+  renumber();
+  return true;
+}
+
+void lumpability::renumber()
+{
+  std::map<std::uint64_t, std::uint64_t> numbers;
+  m_sizes.clear();
+  m_representatives.clear();
+
+  for (std::uint64_t i = 0; i < m_blocks.size(); i++)
+  {
+    auto inserted = numbers.insert(std::make_pair(m_blocks[i], numbers.size()));
+    if (inserted.second)
+    {
+      m_sizes.push_back(0);
+      m_representatives.push_back(i);
+    }
+    m_blocks[i] = inserted.first->second;
+    m_sizes[m_blocks[i]]++;
+  }
+}
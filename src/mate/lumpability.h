@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <vector>
+
+/// A partition of the states of a markov chain into blocks, which can be lumped together into a
+/// single state each without changing the behaviour of the chain. The coarsest such partition is
+/// found by partition refinement: starting from a single block (or a given partition), blocks are
+/// split by the transition probabilities of their states from or into every other block until no
+/// block can be split anymore.
+/// - ordinary lumpability: every state of a block has the same probability to move into each
+///   block. The probabilities of the blocks are exact, the distribution within a block is lost.
+/// - exact lumpability: every state of a block receives the same probability from each block.
+///   If the initial state vector is uniform within each block, it stays uniform in every step, so
+///   the probabilities of the states are restored exactly from those of the blocks.
+/// A chain is solved on the aggregate, e.g. by markov_chain::lump(), and its results are mapped
+/// back to the original states with expand(). As every chain is trivially lumpable into a single
+/// block, the refinement should start from a partition of the states that must be distinguished,
+/// e.g. by label().
+class lumpability
+{
+public:
+  enum class kind
+  {
+    ordinary,
+    exact
+  };
+
+  /// Find the coarsest lumpable partition of the given transition matrix.
+  /// \param _transition_matrix Matrix of transition probabilities.
+  /// \param _kind Kind of lumpability.
+  /// \param _initial_partition (optional) label of each state. States with different labels are
+  ///   never lumped together, e.g. states with different emissions or initial probabilities.
+  ///   A partition of a different number of states than the transition matrix is reported and
+  ///   rejected, every state then remains a block of its own.
+  /// \param _tolerance Probabilities closer than the tolerance are considered equal.
+  lumpability(
+    const Eigen::MatrixXd& _transition_matrix,
+    const kind _kind = kind::ordinary,
+    const std::vector<std::uint64_t>& _initial_partition = std::vector<std::uint64_t>(),
+    const double _tolerance = 1.0e-12
+  );
+
+  /// Label the states by their properties, e.g. emission probabilities, as an initial partition.
+  /// Partition refinement needs one, as every chain is trivially lumpable into a single block.
+  /// \param _properties properties (columns) of each state (rows).
+  /// \param _tolerance Properties closer than the tolerance are considered equal.
+  /// \return the label of each state. States of equal properties share their label.
+  static std::vector<std::uint64_t> label(const Eigen::MatrixXd& _properties, const double _tolerance = 1.0e-12);
+
+  /// \return the kind of lumpability.
+  kind type() const { return m_kind; }
+
+  /// \return the number of states of the original chain.
+  std::uint64_t state_count() const { return m_blocks.size(); }
+
+  /// \return the number of blocks, the states of the aggregated chain.
+  std::uint64_t block_count() const { return m_sizes.size(); }
+
+  /// \return the block of each state.
+  const std::vector<std::uint64_t>& blocks() const { return m_blocks; }
+
+  /// \return the first state of each block.
+  const std::vector<std::uint64_t>& representatives() const { return m_representatives; }
+
+  /// Aggregate a transition matrix over the blocks. Rows of a block are averaged, columns of a
+  /// block are summed up.
+  /// \param _transition_matrix Matrix of transition probabilities, which has to be lumpable by
+  ///   this partition.
+  /// \return the transition matrix of the aggregated chain.
+  Eigen::MatrixXd aggregate(const Eigen::MatrixXd& _transition_matrix) const;
+
+  /// Aggregate a state vector by summing up the probabilities of each block.
+  /// \param _state_vector state vector of the original chain.
+  /// \return state vector of the aggregated chain.
+  Eigen::RowVectorXd aggregate(const Eigen::RowVectorXd& _state_vector) const;
+
+  /// Map a state vector of the aggregated chain back to the original states. The probability of
+  /// a block is spread uniformly among its states, which is exact for exact lumpability.
+  /// \param _aggregated_state_vector state vector of the aggregated chain.
+  /// \return state vector of the original chain.
+  Eigen::RowVectorXd expand(const Eigen::RowVectorXd& _aggregated_state_vector) const;
+
+  /// Map a state vector of the aggregated chain back to the original states. The probability of
+  /// a block is spread among its states in proportion to the given weights, e.g. a known
+  /// distribution within the blocks of an ordinarily lumpable chain.
+  /// \param _aggregated_state_vector state vector of the aggregated chain.
+  /// \param _weights relative weight of each original state.
+  /// \return state vector of the original chain.
+  Eigen::RowVectorXd expand(
+    const Eigen::RowVectorXd& _aggregated_state_vector,
+    const Eigen::RowVectorXd& _weights
+  ) const;
+
+private:
+  /// Split the blocks by the transition probabilities of their states from or into each block.
+  /// \param _transition_matrix Matrix of transition probabilities.
+  /// \param _tolerance Probabilities closer than the tolerance are considered equal.
+  /// \return whether any block has been split.
+  bool refine(const Eigen::MatrixXd& _transition_matrix, const double _tolerance);
+
+  /// Number the blocks in order of their first state and update the sizes and representatives.
+  void renumber();
+
+  /// Kind of lumpability.
+  kind m_kind;
+
+  /// Block of each state.
+  std::vector<std::uint64_t> m_blocks;
+
+  /// Number of states in each block.
+  std::vector<std::uint64_t> m_sizes;
+
+  /// First state of each block.
+  std::vector<std::uint64_t> m_representatives;
+};
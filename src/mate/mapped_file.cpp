@@ -0,0 +1,85 @@
+#include "mapped_file.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string& _path)
+  : m_data(nullptr)
+  , m_size(0)
+  , m_mapping(nullptr)
+{
+  HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    std::cout << "File " << _path << " could not be opened." << std::endl;
+    return;
+  }
+
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+  {
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping != nullptr)
+    {
+      m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+      m_size = (m_data != nullptr) ? size.QuadPart : 0;
+    }
+  }
+  CloseHandle(file); // the mapping keeps the file open
+}
+
+mapped_file::~mapped_file()
+{
+  if (m_data != nullptr) { UnmapViewOfFile(m_data); }
+  if (m_mapping != nullptr) { CloseHandle(m_mapping); }
+}
+
+#else
+
+mapped_file::mapped_file(const std::string& _path)
+  : m_data(nullptr)
+  , m_size(0)
+{
+  const int file = open(_path.c_str(), O_RDONLY);
+  if (file < 0)
+  {
+    std::cout << "File " << _path << " could not be opened." << std::endl;
+    return;
+  }
+
+  struct stat status;
+  if (fstat(file, &status) == 0 && status.st_size > 0)
+  {
+    void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (data != MAP_FAILED)
+    {
+      madvise(data, status.st_size, MADV_SEQUENTIAL);
+      m_data = static_cast<const char*>(data);
+      m_size = status.st_size;
+    }
+  }
+  close(file); // the mapping keeps the file open
+}
+
+mapped_file::~mapped_file()
+{
+  if (m_data != nullptr) { munmap(const_cast<char*>(m_data), m_size); }
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/// A read-only view of a whole file mapped into memory. The pages are loaded by the operating
+/// system on first access, so even files larger than the main memory can be scanned in place
+/// without copying them into a buffer.
+class mapped_file
+{
+public:
+  /// Map the given file into memory. Check is_open() for success.
+  /// \param _path path of the file.
+  mapped_file(const std::string& _path);
+
+  /// Unmap the file.
+  ~mapped_file();
+
+  /// \return whether the file has been mapped. An empty file is never mapped.
+  bool is_open() const { return m_data != nullptr; }
+
+  /// \return the first byte of the file.
+  const char* data() const { return m_data; }
+
+  /// \return the size of the file in bytes.
+  std::uint64_t size() const { return m_size; }
+
+private:
+  mapped_file(const mapped_file&);
+  mapped_file& operator=(const mapped_file&);
+
+  /// First byte of the mapping.
+  const char* m_data;
+
+  /// Size of the mapping in bytes.
+  std::uint64_t m_size;
+
+#ifdef _WIN32
+  /// Handle of the file mapping object.
+  void* m_mapping;
+#endif
+};
@@ -1,19 +1,64 @@
 #pragma once
 
 #include "discrete_distribution.h"
+#include "log_space.h"
+#include "lumpability.h"
+#include "per_state_emissions.h"
+#include "trace.h"
 
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <cmath>
 #include <complex>
 #include <vector>
 #include <cstdint>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 
-template<typename distribution = discrete_distribution>
+namespace markov_chain_detail {
+
+/// Multiply the state vector with the transition matrix.
+inline void step(
+  const Eigen::RowVectorXd& _current,
+  const Eigen::MatrixXd& _transition_matrix,
+  Eigen::RowVectorXd& _next)
+{
+  _next.noalias() = _current * _transition_matrix;
+}
+
+/// Multiply the state vector with a transition matrix of lower precision. Each element is
+/// accumulated in double precision directly from the stored matrix, without a converted copy.
+template<typename scalar>
+void step(
+  const Eigen::RowVectorXd& _current,
+  const Eigen::Matrix<scalar, Eigen::Dynamic, Eigen::Dynamic>& _transition_matrix,
+  Eigen::RowVectorXd& _next)
+{
+  for (std::uint64_t j = 0; j < static_cast<std::uint64_t>(_transition_matrix.cols()); j++)
+  {
+    _next[j] = _transition_matrix.col(j).template cast<double>().dot(_current.transpose());
+  }
+}
+
+}; // namespace markov_chain_detail
+
+/// A (hidden) markov chain with an emission probability distribution in each state.
+/// \tparam distribution Type of the emission probability distributions.
+/// \tparam emission_policy Storage of the emission probability distributions, e.g.
+///   per_state_emissions (default) or packed_emissions.
+/// \tparam scalar Storage type of the transition matrix. With float, the matrix takes half the
+///   memory and bandwidth, while state vectors, norms and accumulators remain double.
+template<
+  typename distribution = discrete_distribution,
+  typename emission_policy = per_state_emissions<distribution>,
+  typename scalar = double
+>
 class markov_chain
 {
 public:
+  typedef Eigen::Matrix<scalar, Eigen::Dynamic, Eigen::Dynamic> transition_matrix_type;
 
   /// Constructor of a default, uniformly distributed markov chain.
   /// \param _state_count Total number of states.
@@ -49,8 +94,10 @@ public:
   /// \param _epsilon Threshold for the rate of change of the state vector between each step,
   ///   measured in euclidean distance. Set epsilon to a negative value to deactivate its break
   ///   condition. An epsilon of zero achieves the maximum available numerical precision obtainable
-  ///   by the specific hard- & software.
-  void estimate(
+  ///   by the specific hard- & software. An epsilon below the precision of the scalar type is
+  ///   reported and raised to it.
+  /// \return the estimated state vector.
+  Eigen::RowVectorXd estimate(
     const std::uint64_t _steps = std::numeric_limits<uint64_t>::max(),
     const double _epsilon = 0
   );
@@ -64,21 +111,116 @@ public:
   ///   measured in euclidean distance. Set epsilon to a negative value to deactivate its break
   ///   condition. An epsilon of zero achieves the maximum available numerical precision obtainable
   ///   by the specific hard- & software. Tests have proven numerically unstable at
-  ///   epsilon < 1.0e-12.
-  void estimate_power(
+  ///   epsilon < 1.0e-12. An epsilon below the precision of the scalar type is reported and raised
+  ///   to it.
+  /// \return the estimated state vector.
+  Eigen::RowVectorXd estimate_power(
     const std::uint64_t _steps = std::numeric_limits<uint64_t>::max(),
     const double _epsilon = 1.0e-8
   );
 
+  /// Find the coarsest lumpable partition of the states, which keeps states of different
+  /// emissions apart, and for exact lumpability also states of different initial probabilities.
+  /// Requires distributions with a vector of probabilities, e.g. discrete_distribution.
+  /// \param _kind Kind of lumpability.
+  /// \param _tolerance Probabilities closer than the tolerance are considered equal.
+  /// \return the lumpable partition.
+  lumpability lumpable_partition(
+    const lumpability::kind _kind = lumpability::kind::ordinary,
+    const double _tolerance = 1.0e-12
+  ) const;
+
+  /// Reduce the chain to the aggregate of a lumpable partition of its states. Every state of the
+  /// aggregated chain takes the emissions of the representative of its block, so states with
+  /// different emissions should be kept apart by the initial partition of the lumpability. Results
+  /// of the aggregated chain are mapped back with lumpability::expand().
+  /// \param _lumpability lumpable partition of the states of this chain.
+  /// \return the aggregated chain.
+  markov_chain lump(const lumpability& _lumpability) const;
+
+  /// \return the initial state vector.
+  const Eigen::RowVectorXd& initial_state() const { return m_initial_state; }
+
+  /// Modify the initial state vector.
+  /// \return reference to the initial state vector.
+  Eigen::RowVectorXd& initial_state() { return m_initial_state; }
+
+  /// \return the transition probability matrix.
+  const transition_matrix_type& transition_matrix() const { return m_transition_matrix; }
+
+  /// Modify the transition probability matrix.
+  /// \return reference to the transition probability matrix.
+  transition_matrix_type& transition_matrix() { return m_transition_matrix; }
+
+  /// \return the emission probabilities of all states.
+  const emission_policy& emissions() const { return m_emissions; }
+
+  /// Modify the emission probabilities of all states.
+  /// \return reference to the emission probabilities of all states.
+  emission_policy& emissions() { return m_emissions; }
+
+  /// \return the vector of emission probability distributions. One for each state. Only available
+  ///   with per_state_emissions.
+  const std::vector<distribution>& emission_distributions() const { return m_emissions.distributions(); }
+
+  /// Modify the vector of emission probability distributions. Only available with
+  /// per_state_emissions.
+  /// \return reference to the vector of emission probability distributions.
+  std::vector<distribution>& emission_distributions() { return m_emissions.distributions(); }
+
+  /// Compute the log-likelihood of the observation sequence by the forward algorithm. The
+  /// forward variables are rescaled after each step to prevent them from underflowing.
+  /// \param _sequence Sequence of observations.
+  /// \return natural logarithm of the probability of the observation sequence.
+  double log_likelihood(const std::vector<std::uint64_t>& _sequence) const;
+
+  /// Compute the log-likelihood of the observation sequence by the forward algorithm, with
+  /// forward variables provided by the caller. Nothing is allocated once the buffers have the size
+  /// of the state vector, so a worker scoring many sequences reuses them for each one.
+  /// \param _count Number of observations.
+  /// \param _sequence Contiguous array of observations.
+  /// \param _alpha storage of the forward variables, resized to the number of states.
+  /// \param _next storage of the next forward variables, resized to the number of states.
+  /// \return natural logarithm of the probability of the observation sequence.
+  double log_likelihood(
+    const std::uint64_t _count,
+    const std::uint64_t* _sequence,
+    Eigen::RowVectorXd& _alpha,
+    Eigen::RowVectorXd& _next
+  ) const;
+
+  /// Compute the log-likelihood of the observation sequence by the forward algorithm entirely in
+  /// log-space. Each step rescales the forward variables by their maximum, so the largest one never
+  /// underflows however long the sequence and the sequence is scored in a single pass without the
+  /// rescaling of log_likelihood(). States more than about 745 below the most likely one in
+  /// log-space still flush to zero for that step.
+  /// \param _count Number of observations.
+  /// \param _sequence Contiguous array of observations.
+  /// \return natural logarithm of the probability of the observation sequence.
+  double log_forward(const std::uint64_t _count, const std::uint64_t* _sequence) const;
+
+  /// Compute the most likely sequence of states to emit the observation sequence by the Viterbi
+  /// algorithm in log-space.
+  /// \param _sequence Sequence of observations.
+  /// \return the most likely sequence of states. One for each observation.
+  std::vector<std::uint64_t> viterbi(const std::vector<std::uint64_t>& _sequence) const;
+
 private:
+  /// Raise the threshold of a convergence check to the precision attainable with the scalar type
+  /// of the transition matrix, and report if the requested threshold is out of reach.
+  /// \param _epsilon requested threshold.
+  /// \param _norm norm of the state vector, the scale of the attainable precision.
+  /// \return the attainable threshold.
+  double attainable_epsilon(const double _epsilon, const double _norm) const;
+
   /// Initial state vector.
   Eigen::RowVectorXd m_initial_state;
 
   /// Transition probability matrix.
-  Eigen::MatrixXd m_transition_matrix;
+  transition_matrix_type m_transition_matrix;
 
-  /// Vector of emission probability distributions. One for each state.
-  std::vector<distribution> m_emission_distributions;
+  /// Emission probability distributions. One for each state.
+  emission_policy m_emissions;
 
 };
 
@@ -86,72 +228,284 @@ private:
 // implementation
 // -------------------------------------------------------------------------------------------------
 
-template<typename distribution/* = discrete_distribution */>
-markov_chain<distribution>::markov_chain(
+template<typename distribution, typename emission_policy, typename scalar>
+markov_chain<distribution, emission_policy, scalar>::markov_chain(
   const std::uint64_t _state_count,
   const distribution& _emission_distribution
 ) : m_initial_state(Eigen::RowVectorXd::Ones(_state_count) / static_cast<double>(_state_count))
-  , m_transition_matrix(Eigen::MatrixXd::Ones(_state_count,_state_count) / static_cast<double>(_state_count))
-  , m_emission_distributions(_state_count,_emission_distribution)
+  , m_transition_matrix(transition_matrix_type::Ones(_state_count,_state_count) / static_cast<scalar>(_state_count))
+  , m_emissions(std::vector<distribution>(_state_count,_emission_distribution))
 {
   /* empty */
 }
 
-template<typename distribution/* = discrete_distribution */>
-markov_chain<distribution>::markov_chain(
+template<typename distribution, typename emission_policy, typename scalar>
+markov_chain<distribution, emission_policy, scalar>::markov_chain(
   const Eigen::RowVectorXd& _initial_state,
   const Eigen::MatrixXd& _transition_matrix,
   const std::vector<distribution>& _emission_distributions
 ) : m_initial_state(_initial_state)
-  , m_transition_matrix(_transition_matrix)
-  , m_emission_distributions(_emission_distributions)
+  , m_transition_matrix(_transition_matrix.template cast<scalar>())
+  , m_emissions(_emission_distributions)
 {
   /* empty */
 }
 
-template<typename distribution/* = discrete_distribution */>
-Eigen::MatrixXd markov_chain<distribution>::from_ctmc(const Eigen::MatrixXd& _generator_matrix, const double _delta_t)
+template<typename distribution, typename emission_policy, typename scalar>
+Eigen::MatrixXd markov_chain<distribution, emission_policy, scalar>::from_ctmc(const Eigen::MatrixXd& _generator_matrix, const double _delta_t)
 {
   Eigen::MatrixXd identity_matrix = Eigen::MatrixXd::Identity(_generator_matrix.rows(),_generator_matrix.cols());
   return identity_matrix + _delta_t * _generator_matrix;
 }
 
-template<typename distribution/* = discrete_distribution */>
-void markov_chain<distribution>::estimate(const std::uint64_t _steps, const double _epsilon)
+template<typename distribution, typename emission_policy, typename scalar>
+Eigen::RowVectorXd markov_chain<distribution, emission_policy, scalar>::estimate(const std::uint64_t _steps, const double _epsilon)
 {
-  auto current = m_initial_state; // row vector
+  MATE_TRACE_SCOPE("markov_chain::estimate");
+
+  const double epsilon = attainable_epsilon(_epsilon, m_initial_state.norm());
+
+  Eigen::RowVectorXd current = m_initial_state;
+  Eigen::RowVectorXd last(current.size());
 
   std::uint64_t i;
   for (i = 0; i < _steps; i++)
   {
-    auto last = current;
-    current = last * m_transition_matrix;
+    last.swap(current);
+    markov_chain_detail::step(last, m_transition_matrix, current);
     auto difference = current - last;
     auto distance = difference.norm();
 
-    if (distance <= _epsilon) { break; }
+    if (distance <= epsilon) { break; }
   }
+  MATE_TRACE_COUNTER("markov_chain::estimate steps", i);
 
-  std::cout << std::setprecision(10) << "estimate " << current << " after " << i << " steps with a precision of " << _epsilon << "." << std::endl;
+  std::cout << std::setprecision(10) << "estimate " << current << " after " << i << " steps with a precision of " << epsilon << "." << std::endl;
+
+  return current;
 }
 
-template<typename distribution/* = discrete_distribution */>
-void markov_chain<distribution>::estimate_power(const std::uint64_t _steps, const double _epsilon)
+template<typename distribution, typename emission_policy, typename scalar>
+Eigen::RowVectorXd markov_chain<distribution, emission_policy, scalar>::estimate_power(const std::uint64_t _steps, const double _epsilon)
 {
-  auto current = m_transition_matrix; // square matrix
+  MATE_TRACE_SCOPE("markov_chain::estimate_power");
+
+  transition_matrix_type current = m_transition_matrix; // square matrix
+  transition_matrix_type last(current.rows(), current.cols());
+  const double epsilon = attainable_epsilon(_epsilon, current.row(0).template cast<double>().norm());
 
   std::uint64_t i;
   for (i = 0; i < _steps; i++)
   {
-    auto last = current;
-    // another way to efficient, precise runtime solutions of pow(matrix,n) without the danger of
-    // aliasing would be a constexpr or expression templates
-    current = last * last;
-    auto difference = current.row(0) - last.row(0);
-    auto distance = difference.norm();
+    // the product is evaluated directly into the storage of the last but one power
+    last.swap(current);
+    current.noalias() = last * last;
+    if (std::numeric_limits<scalar>::epsilon() > std::numeric_limits<double>::epsilon())
+    {
+      // the rounding error of the row sums would otherwise grow with every squaring
+      for (std::uint64_t r = 0; r < static_cast<std::uint64_t>(current.rows()); r++)
+      {
+        current.row(r) /= current.row(r).sum();
+      }
+    }
+    const double distance = (current.row(0).template cast<double>() - last.row(0).template cast<double>()).norm();
+
+#ifdef MATE_TRACE
+    // rows which already meet the threshold, the break condition only looks at the first one
+    std::uint64_t converged = 0;
+    for (std::uint64_t r = 0; r < static_cast<std::uint64_t>(current.rows()); r++)
+    {
+      if ((current.row(r).template cast<double>() - last.row(r).template cast<double>()).norm() <= epsilon) { converged++; }
+    }
+    MATE_TRACE_COUNTER("markov_chain::estimate_power converged rows", converged);
+#endif
+
+    if (distance <= epsilon) { break; }
+  }
+  MATE_TRACE_COUNTER("markov_chain::estimate_power squarings", i);
+
+  std::cout << std::setprecision(10) << "estimate " << current.row(0) << " after " << i << " steps with a precision of " << epsilon << "." << std::endl;
+
+  return current.row(0).template cast<double>();
+}
 
-    if (distance <= _epsilon) { break; }
+template<typename distribution, typename emission_policy, typename scalar>
+lumpability markov_chain<distribution, emission_policy, scalar>::lumpable_partition(const lumpability::kind _kind, const double _tolerance) const
+{
+  const std::uint64_t state_count = m_initial_state.size();
+
+  // emission probabilities (and the initial probability) of each state (rows)
+  std::uint64_t symbol_count = 0;
+  for (std::uint64_t j = 0; j < state_count; j++)
+  {
+    symbol_count = std::max<std::uint64_t>(symbol_count, m_emissions.state(j).probabilities().size());
+  }
+  Eigen::MatrixXd properties = Eigen::MatrixXd::Zero(state_count, symbol_count + 1);
+  for (std::uint64_t j = 0; j < state_count; j++)
+  {
+    const Eigen::VectorXd probabilities = m_emissions.state(j).probabilities();
+    properties.row(j).head(probabilities.size()) = probabilities.transpose();
+  }
+  if (_kind == lumpability::kind::exact)
+  {
+    properties.col(symbol_count) = m_initial_state.transpose();
+  }
+
+  return lumpability(
+    m_transition_matrix.template cast<double>().eval(),
+    _kind,
+    lumpability::label(properties, _tolerance),
+    _tolerance);
+}
+
+template<typename distribution, typename emission_policy, typename scalar>
+markov_chain<distribution, emission_policy, scalar> markov_chain<distribution, emission_policy, scalar>::lump(const lumpability& _lumpability) const
+{
+  std::vector<distribution> distributions;
+  distributions.reserve(_lumpability.block_count());
+  for (const auto representative : _lumpability.representatives())
+  {
+    distributions.push_back(m_emissions.state(representative));
+  }
+
+  return markov_chain(
+    _lumpability.aggregate(m_initial_state),
+    _lumpability.aggregate(m_transition_matrix.template cast<double>().eval()),
+    distributions);
+}
+
+template<typename distribution, typename emission_policy, typename scalar>
+double markov_chain<distribution, emission_policy, scalar>::log_likelihood(const std::vector<std::uint64_t>& _sequence) const
+{
+  Eigen::RowVectorXd alpha;
+  Eigen::RowVectorXd next;
+  return log_likelihood(_sequence.size(), _sequence.data(), alpha, next);
+}
+
+template<typename distribution, typename emission_policy, typename scalar>
+double markov_chain<distribution, emission_policy, scalar>::log_likelihood(
+  const std::uint64_t _count,
+  const std::uint64_t* _sequence,
+  Eigen::RowVectorXd& _alpha,
+  Eigen::RowVectorXd& _next) const
+{
+  MATE_TRACE_SCOPE("markov_chain::log_likelihood");
+
+  if (_count == 0) { return 0; }
+
+  // reuses the storage of the buffers, unless the state count differs
+  _alpha = m_initial_state;
+  _next.resize(_alpha.size());
+  m_emissions.emit(_sequence[0], _alpha);
+
+  double result = 0;
+  for (std::uint64_t t = 0; t < _count; t++)
+  {
+    if (t > 0)
+    {
+      markov_chain_detail::step(_alpha, m_transition_matrix, _next);
+      m_emissions.emit(_sequence[t], _next);
+      _alpha.swap(_next);
+    }
+
+    const double scale = _alpha.sum();
+    if (scale <= 0) { return -std::numeric_limits<double>::infinity(); }
+    _alpha /= scale;
+    result += std::log(scale);
+  }
+
+  return result;
+}
+
+template<typename distribution, typename emission_policy, typename scalar>
+double markov_chain<distribution, emission_policy, scalar>::log_forward(const std::uint64_t _count, const std::uint64_t* _sequence) const
+{
+  MATE_TRACE_SCOPE("markov_chain::log_forward");
+
+  if (_count == 0) { return 0; }
+
+  Eigen::RowVectorXd log_alpha = m_initial_state.array().log();
+  Eigen::RowVectorXd shifted(log_alpha.size());
+  Eigen::RowVectorXd next(log_alpha.size());
+  m_emissions.log_emit(_sequence[0], log_alpha);
+
+  for (std::uint64_t t = 1; t < _count; t++)
+  {
+    // log(alpha * T) = max + log(exp(log_alpha - max) * T)
+    const double max = math::to_shifted(log_alpha, shifted);
+    if (!std::isfinite(max)) { return -std::numeric_limits<double>::infinity(); }
+
+    markov_chain_detail::step(shifted, m_transition_matrix, next);
+    math::from_shifted(next, max, log_alpha);
+    m_emissions.log_emit(_sequence[t], log_alpha);
+  }
+
+  return math::logsumexp(log_alpha);
+}
+
+template<typename distribution, typename emission_policy, typename scalar>
+std::vector<std::uint64_t> markov_chain<distribution, emission_policy, scalar>::viterbi(const std::vector<std::uint64_t>& _sequence) const
+{
+  MATE_TRACE_SCOPE("markov_chain::viterbi");
+
+  const std::uint64_t length = _sequence.size();
+  const std::uint64_t state_count = m_initial_state.size();
+  std::vector<std::uint64_t> result(length);
+
+  if (length == 0) { return result; }
+
+  // transposed into row-major storage, so that the transitions into a state are contiguous
+  const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> log_transition_matrix = m_transition_matrix.transpose().template cast<double>().array().log();
+
+  // most likely predecessor of each state (columns) at each step (rows)
+  Eigen::Matrix<std::uint64_t, Eigen::Dynamic, Eigen::Dynamic> predecessor(length, state_count);
+
+  Eigen::RowVectorXd delta = m_initial_state.array().log();
+  Eigen::RowVectorXd next(state_count);
+  m_emissions.log_emit(_sequence[0], delta);
+
+  for (std::uint64_t t = 1; t < length; t++)
+  {
+    for (std::uint64_t j = 0; j < state_count; j++)
+    {
+      Eigen::MatrixXd::Index i;
+      next[j] = (delta + log_transition_matrix.row(j)).maxCoeff(&i);
+      predecessor(t, j) = i;
+    }
+    m_emissions.log_emit(_sequence[t], next);
+    delta.swap(next);
+  }
+
+  // backtrack from the most likely final state
+  Eigen::MatrixXd::Index last;
+  delta.maxCoeff(&last);
+  result[length - 1] = last;
+  for (std::uint64_t t = length - 1; t > 0; t--)
+  {
+    result[t - 1] = predecessor(t, result[t]);
+  }
+
+  return result;
+}
+
+template<typename distribution, typename emission_policy, typename scalar>
+double markov_chain<distribution, emission_policy, scalar>::attainable_epsilon(const double _epsilon, const double _norm) const
+{
+  // a negative epsilon deactivates the break condition, double precision is never restricted
+  if (_epsilon < 0 || std::numeric_limits<scalar>::epsilon() <= std::numeric_limits<double>::epsilon())
+  {
+    return _epsilon;
+  }
+
+  // rounding the transition probabilities perturbs every step by about one unit in the last place
+  // of the scalar type, the distance between two steps will not fall below that
+  const double attainable = std::numeric_limits<scalar>::epsilon() * std::sqrt(static_cast<double>(m_transition_matrix.rows())) * _norm;
+  if (_epsilon < attainable)
+  {
+    std::cout << "Precision " << _epsilon << " is not attainable with a transition matrix of "
+      << std::numeric_limits<scalar>::digits << " bit mantissa, using " << attainable << " instead." << std::endl;
+    return attainable;
   }
 
-  std::cout << std::setprecision(10) << "estimate " << current.row(0) << " after " << i << " steps with a precision of " << _epsilon << "." << std::endl;
+  return _epsilon;
 }
@@ -0,0 +1,311 @@
+#include "model_file.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+/// Round the offset up to the alignment of a section.
+std::uint64_t align(const std::uint64_t _offset)
+{
+  const std::uint64_t alignment = model_file_format::alignment;
+  return (_offset + alignment - 1) / alignment * alignment;
+}
+
+/// Write a section at the given offset, padding the file up to it.
+void write_section(std::ofstream& _file, const std::uint64_t _offset, const void* _data, const std::uint64_t _size)
+{
+  static const char padding[model_file_format::alignment] = { 0 };
+  const std::uint64_t position = static_cast<std::uint64_t>(_file.tellp());
+  _file.write(padding, _offset - position);
+  _file.write(static_cast<const char*>(_data), _size);
+}
+
+/// Check that the dimensions of a model agree with its number of states, and report otherwise.
+bool consistent(
+  const std::string& _path,
+  const std::uint64_t _state_count,
+  const std::uint64_t _rows,
+  const std::uint64_t _columns,
+  const model_file::emission_table& _emissions)
+{
+  if (_rows != _state_count || _columns != _state_count || static_cast<std::uint64_t>(_emissions.cols()) != _state_count)
+  {
+    std::cout << "Model file " << _path << " not written, the transition matrix and the emissions have to match the " << _state_count << " states." << std::endl;
+    return false;
+  }
+  if (_state_count > std::numeric_limits<std::uint32_t>::max())
+  {
+    std::cout << "Model file " << _path << " not written, the columns of " << _state_count << " states exceed 32 bits." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/// Lay out the sections of a model file and write it.
+/// \param _row_offsets row offsets of the CSR transition matrix, nullptr for a dense matrix.
+/// \param _columns columns of the CSR transition matrix, nullptr for a dense matrix.
+/// \param _values nonzero transition probabilities, or every transition probability of a dense
+///   matrix in column-major order.
+/// \param _nonzero_count number of values.
+bool write_file(
+  const std::string& _path,
+  const Eigen::RowVectorXd& _initial_state,
+  const std::uint64_t* _row_offsets,
+  const std::uint32_t* _columns,
+  const double* _values,
+  const std::uint64_t _nonzero_count,
+  const model_file::emission_table& _emissions)
+{
+  const std::uint64_t state_count = _initial_state.size();
+  const bool sparse = (_row_offsets != nullptr);
+
+  model_file_format::header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, model_file_format::magic, sizeof(header.magic));
+  header.version = model_file_format::version;
+  header.sparse = sparse ? 1 : 0;
+  header.state_count = state_count;
+  header.symbol_count = _emissions.rows();
+  header.nonzero_count = _nonzero_count;
+  header.initial_state_offset = align(sizeof(header));
+  std::uint64_t offset = header.initial_state_offset + state_count * sizeof(double);
+  if (sparse)
+  {
+    header.row_offsets_offset = align(offset);
+    header.columns_offset = align(header.row_offsets_offset + (state_count + 1) * sizeof(std::uint64_t));
+    offset = header.columns_offset + _nonzero_count * sizeof(std::uint32_t);
+  }
+  header.values_offset = align(offset);
+  header.emissions_offset = align(header.values_offset + _nonzero_count * sizeof(double));
+  header.size = header.emissions_offset + _emissions.size() * sizeof(double);
+
+  std::ofstream file(_path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    std::cout << "Model file " << _path << " could not be created." << std::endl;
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_section(file, header.initial_state_offset, _initial_state.data(), state_count * sizeof(double));
+  if (sparse)
+  {
+    write_section(file, header.row_offsets_offset, _row_offsets, (state_count + 1) * sizeof(std::uint64_t));
+    write_section(file, header.columns_offset, _columns, _nonzero_count * sizeof(std::uint32_t));
+  }
+  write_section(file, header.values_offset, _values, _nonzero_count * sizeof(double));
+  write_section(file, header.emissions_offset, _emissions.data(), _emissions.size() * sizeof(double));
+
+  return static_cast<bool>(file);
+}
+
+/// Check that an array of _count elements of _element_size bytes at the given byte offset lies
+/// within a file of _size bytes and is aligned, without overflowing.
+bool fits(const std::uint64_t _offset, const std::uint64_t _count, const std::uint64_t _element_size, const std::uint64_t _size)
+{
+  if (_offset % model_file_format::alignment != 0 || _offset > _size) { return false; }
+  return _count <= (_size - _offset) / _element_size;
+}
+
+/// Multiply two counts, without overflowing.
+/// \return whether the product fits into 64 bits.
+bool multiply(const std::uint64_t _a, const std::uint64_t _b, std::uint64_t& _product)
+{
+  if (_a != 0 && _b > std::numeric_limits<std::uint64_t>::max() / _a) { return false; }
+  _product = _a * _b;
+  return true;
+}
+
+}; // namespace
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+model_file::model_file(const std::string& _path)
+  : m_file(_path)
+  , m_header(nullptr)
+{
+  if (!m_file.is_open() || m_file.size() < sizeof(model_file_format::header)) { return; }
+
+  const model_file_format::header* header = section<model_file_format::header>(0);
+  if (std::memcmp(header->magic, model_file_format::magic, sizeof(header->magic)) != 0
+    || header->version != model_file_format::version)
+  {
+    std::cout << "File " << _path << " is not a model file of version " << model_file_format::version << "." << std::endl;
+    return;
+  }
+  if (header->size != m_file.size() || !valid(*header))
+  {
+    std::cout << "Model file " << _path << " is truncated or corrupted." << std::endl;
+    return;
+  }
+
+  m_header = header;
+}
+
+bool model_file::write(
+  const std::string& _path,
+  const Eigen::RowVectorXd& _initial_state,
+  const Eigen::MatrixXd& _transition_matrix,
+  const emission_table& _emissions,
+  const bool _sparse)
+{
+  if (_sparse)
+  {
+    const Eigen::SparseMatrix<double, Eigen::RowMajor> transition_matrix = _transition_matrix.sparseView();
+    return write(_path, _initial_state, transition_matrix, _emissions);
+  }
+
+  const std::uint64_t state_count = _initial_state.size();
+  if (!consistent(_path, state_count, _transition_matrix.rows(), _transition_matrix.cols(), _emissions)) { return false; }
+
+  return write_file(_path, _initial_state, nullptr, nullptr, _transition_matrix.data(), state_count * state_count, _emissions);
+}
+
+bool model_file::write(
+  const std::string& _path,
+  const Eigen::RowVectorXd& _initial_state,
+  const Eigen::SparseMatrix<double, Eigen::RowMajor>& _transition_matrix,
+  const emission_table& _emissions)
+{
+  const std::uint64_t state_count = _initial_state.size();
+  if (!consistent(_path, state_count, _transition_matrix.rows(), _transition_matrix.cols(), _emissions)) { return false; }
+
+  // CSR of the transition matrix, the matrix may be uncompressed
+  std::vector<std::uint64_t> row_offsets(state_count + 1, 0);
+  std::vector<std::uint32_t> columns;
+  std::vector<double> values;
+  columns.reserve(_transition_matrix.nonZeros());
+  values.reserve(_transition_matrix.nonZeros());
+  for (std::uint64_t i = 0; i < state_count; i++)
+  {
+    for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(_transition_matrix, i); it; ++it)
+    {
+      columns.push_back(static_cast<std::uint32_t>(it.col()));
+      values.push_back(it.value());
+    }
+    row_offsets[i + 1] = values.size();
+  }
+
+  return write_file(_path, _initial_state, row_offsets.data(), columns.data(), values.data(), values.size(), _emissions);
+}
+
+void model_file::step(const Eigen::RowVectorXd& _current, Eigen::RowVectorXd& _next) const
+{
+  if (!sparse())
+  {
+    _next.noalias() = _current * transition_matrix();
+    return;
+  }
+
+  const std::uint64_t* row_offsets = section<std::uint64_t>(m_header->row_offsets_offset);
+  const std::uint32_t* columns = section<std::uint32_t>(m_header->columns_offset);
+  const double* values = section<double>(m_header->values_offset);
+
+  _next.setZero();
+  for (std::uint64_t i = 0; i < state_count(); i++)
+  {
+    const double probability = _current[i];
+    if (probability == 0) { continue; }
+    for (std::uint64_t k = row_offsets[i]; k < row_offsets[i + 1]; k++)
+    {
+      _next[columns[k]] += probability * values[k];
+    }
+  }
+}
+
+Eigen::RowVectorXd model_file::estimate(const std::uint64_t _steps, const double _epsilon) const
+{
+  Eigen::RowVectorXd current = initial_state();
+  Eigen::RowVectorXd last(current.size());
+
+  for (std::uint64_t i = 0; i < _steps; i++)
+  {
+    last.swap(current);
+    step(last, current);
+
+    if ((current - last).norm() <= _epsilon) { break; }
+  }
+
+  return current;
+}
+
+double model_file::log_likelihood(const std::uint64_t _count, const std::uint64_t* _sequence) const
+{
+  const Eigen::Map<const emission_table> table = emissions();
+
+  Eigen::RowVectorXd alpha = initial_state();
+  Eigen::RowVectorXd next(alpha.size());
+
+  double result = 0;
+  for (std::uint64_t t = 0; t < _count; t++)
+  {
+    if (t > 0)
+    {
+      step(alpha, next);
+      alpha.swap(next);
+    }
+    if (_sequence[t] >= symbol_count()) { return -std::numeric_limits<double>::infinity(); }
+    alpha.array() *= table.row(_sequence[t]).array();
+
+    const double scale = alpha.sum();
+    if (scale <= 0) { return -std::numeric_limits<double>::infinity(); }
+    alpha /= scale;
+    result += std::log(scale);
+  }
+
+  return result;
+}
+
+// -------------------------------------------------------------------------------------------------
+// private
+// -------------------------------------------------------------------------------------------------
+
+bool model_file::valid(const model_file_format::header& _header) const
+{
+  const std::uint64_t size = m_file.size();
+  const std::uint64_t state_count = _header.state_count;
+
+  std::uint64_t emission_count = 0;
+  if (!multiply(_header.symbol_count, state_count, emission_count)
+    || !fits(_header.initial_state_offset, state_count, sizeof(double), size)
+    || !fits(_header.values_offset, _header.nonzero_count, sizeof(double), size)
+    || !fits(_header.emissions_offset, emission_count, sizeof(double), size))
+  {
+    return false;
+  }
+
+  if (_header.sparse == 0)
+  {
+    std::uint64_t dense_count = 0;
+    return multiply(state_count, state_count, dense_count) && _header.nonzero_count == dense_count;
+  }
+
+  // the indices of the CSR are used unchecked by step()
+  if (state_count == std::numeric_limits<std::uint64_t>::max()
+    || !fits(_header.row_offsets_offset, state_count + 1, sizeof(std::uint64_t), size)
+    || !fits(_header.columns_offset, _header.nonzero_count, sizeof(std::uint32_t), size))
+  {
+    return false;
+  }
+
+  const std::uint64_t* row_offsets = section<std::uint64_t>(_header.row_offsets_offset);
+  if (row_offsets[0] != 0 || row_offsets[state_count] != _header.nonzero_count) { return false; }
+  for (std::uint64_t i = 0; i < state_count; i++)
+  {
+    if (row_offsets[i] > row_offsets[i + 1]) { return false; }
+  }
+
+  const std::uint32_t* columns = section<std::uint32_t>(_header.columns_offset);
+  for (std::uint64_t k = 0; k < _header.nonzero_count; k++)
+  {
+    if (columns[k] >= state_count) { return false; }
+  }
+
+  return true;
+}
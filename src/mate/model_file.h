@@ -0,0 +1,203 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "packed_emissions.h"
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+/// Layout of the binary model file of a hidden markov chain with discrete emissions. All values
+/// are stored in the byte order of the machine which wrote the file, every section starts on a
+/// multiple of 64 bytes.
+/// - header
+/// - initial state vector: state_count doubles
+/// - transition matrix, either
+///   dense: state_count * state_count doubles in column-major order, or
+///   sparse (CSR): state_count + 1 row offsets (uint64), nonzero_count columns (uint32) and
+///   nonzero_count values (double)
+/// - emission probabilities: symbol_count * state_count doubles, symbols (rows) times states
+///   (columns) in row-major order, as in packed_emissions
+namespace model_file_format {
+
+const char magic[4] = { 'M', 'M', 'D', 'L' };
+const std::uint32_t version = 1;
+const std::uint64_t alignment = 64;
+
+struct header
+{
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t sparse;        ///< whether the transition matrix is stored in CSR format
+  std::uint64_t state_count;
+  std::uint64_t symbol_count;
+  std::uint64_t nonzero_count; ///< number of stored transition probabilities
+  std::uint64_t initial_state_offset;
+  std::uint64_t row_offsets_offset;
+  std::uint64_t columns_offset;
+  std::uint64_t values_offset;
+  std::uint64_t emissions_offset;
+  std::uint64_t size;          ///< size of the whole file in bytes
+};
+
+}; // namespace model_file_format
+
+/// A hidden markov chain with discrete emissions, used in place from a memory-mapped model file.
+/// Loading takes no longer than mapping the file, however large the model, as every vector and
+/// matrix is viewed through an Eigen::Map instead of being copied. Pages are only read from disk
+/// when first touched, except for the indices of a sparse transition matrix, which are validated
+/// once on opening.
+class model_file
+{
+public:
+  typedef packed_emissions::table emission_table;
+
+  /// Map the given model file. Check is_open() for success.
+  /// \param _path path of the model file.
+  model_file(const std::string& _path);
+
+  /// Write a model file.
+  /// \param _path path of the model file.
+  /// \param _initial_state Vector of initial state probabilities.
+  /// \param _transition_matrix Matrix of transition probabilities.
+  /// \param _emissions Emission probability of each symbol (rows) in each state (columns).
+  /// \param _sparse whether to store only the nonzero transition probabilities (CSR).
+  /// \return whether the file has been written.
+  static bool write(
+    const std::string& _path,
+    const Eigen::RowVectorXd& _initial_state,
+    const Eigen::MatrixXd& _transition_matrix,
+    const emission_table& _emissions,
+    const bool _sparse
+  );
+
+  /// Write a model file with a sparse transition matrix (CSR), without ever forming the dense
+  /// matrix. Every stored entry is written, including explicit zeros.
+  /// \param _path path of the model file.
+  /// \param _initial_state Vector of initial state probabilities.
+  /// \param _transition_matrix Matrix of transition probabilities.
+  /// \param _emissions Emission probability of each symbol (rows) in each state (columns).
+  /// \return whether the file has been written.
+  static bool write(
+    const std::string& _path,
+    const Eigen::RowVectorXd& _initial_state,
+    const Eigen::SparseMatrix<double, Eigen::RowMajor>& _transition_matrix,
+    const emission_table& _emissions
+  );
+
+  /// Write the model file of a markov chain with discrete emissions, e.g. markov_chain<> or
+  /// markov_chain<discrete_distribution, packed_emissions>.
+  /// \param _path path of the model file.
+  /// \param _markov_chain markov chain to write.
+  /// \param _sparse whether to store only the nonzero transition probabilities (CSR).
+  /// \return whether the file has been written.
+  template<typename chain>
+  static bool write(const std::string& _path, const chain& _markov_chain, const bool _sparse);
+
+  /// \return whether the file has been mapped and is a valid model file.
+  bool is_open() const { return m_header != nullptr; }
+
+  /// \return the number of states.
+  std::uint64_t state_count() const { return m_header->state_count; }
+
+  /// \return the number of possible observations.
+  std::uint64_t symbol_count() const { return m_header->symbol_count; }
+
+  /// \return whether the transition matrix is stored in CSR format.
+  bool sparse() const { return m_header->sparse != 0; }
+
+  /// \return the initial state vector.
+  Eigen::Map<const Eigen::RowVectorXd> initial_state() const
+  {
+    return Eigen::Map<const Eigen::RowVectorXd>(section<double>(m_header->initial_state_offset), state_count());
+  }
+
+  /// \return the dense transition matrix. Only available if not sparse().
+  Eigen::Map<const Eigen::MatrixXd> transition_matrix() const
+  {
+    return Eigen::Map<const Eigen::MatrixXd>(section<double>(m_header->values_offset), state_count(), state_count());
+  }
+
+  /// \return the emission probability of each symbol (rows) in each state (columns).
+  Eigen::Map<const emission_table> emissions() const
+  {
+    return Eigen::Map<const emission_table>(section<double>(m_header->emissions_offset), symbol_count(), state_count());
+  }
+
+  /// Multiply the state vector with the transition matrix.
+  /// \param _current state vector.
+  /// \param _next preallocated destination of the next state vector.
+  void step(const Eigen::RowVectorXd& _current, Eigen::RowVectorXd& _next) const;
+
+  /// Estimate the state vector after the specified number of steps or if the rate of change
+  /// threshold requirements are met, as markov_chain::estimate().
+  /// \param _steps Number of steps to evaluate.
+  /// \param _epsilon Threshold for the rate of change of the state vector between each step,
+  ///   measured in euclidean distance. Set epsilon to a negative value to deactivate its break
+  ///   condition.
+  /// \return the estimated state vector.
+  Eigen::RowVectorXd estimate(
+    const std::uint64_t _steps = std::numeric_limits<uint64_t>::max(),
+    const double _epsilon = 0
+  ) const;
+
+  /// Compute the log-likelihood of the observation sequence by the scaled forward algorithm.
+  /// \param _count Number of observations.
+  /// \param _sequence Contiguous array of observations.
+  /// \return natural logarithm of the probability of the observation sequence.
+  double log_likelihood(const std::uint64_t _count, const std::uint64_t* _sequence) const;
+
+private:
+  /// Check that every section of the header lies within the mapped file, and that the indices of
+  /// a sparse transition matrix are within its bounds.
+  /// \param _header header of the mapped file.
+  /// \return whether the model file is valid.
+  bool valid(const model_file_format::header& _header) const;
+
+  /// \return the section at the given byte offset.
+  template<typename type>
+  const type* section(const std::uint64_t _offset) const
+  {
+    return reinterpret_cast<const type*>(m_file.data() + _offset);
+  }
+
+  /// Mapped model file.
+  mapped_file m_file;
+
+  /// Header of the model file, nullptr if invalid.
+  const model_file_format::header* m_header;
+};
+
+// -------------------------------------------------------------------------------------------------
+// implementation
+// -------------------------------------------------------------------------------------------------
+
+template<typename chain>
+bool model_file::write(const std::string& _path, const chain& _markov_chain, const bool _sparse)
+{
+  const std::uint64_t state_count = _markov_chain.initial_state().size();
+
+  std::uint64_t symbol_count = 0;
+  for (std::uint64_t j = 0; j < state_count; j++)
+  {
+    symbol_count = std::max<std::uint64_t>(symbol_count, _markov_chain.emissions().state(j).probabilities().size());
+  }
+
+  emission_table emissions = emission_table::Zero(symbol_count, state_count);
+  for (std::uint64_t j = 0; j < state_count; j++)
+  {
+    const Eigen::VectorXd probabilities = _markov_chain.emissions().state(j).probabilities();
+    emissions.col(j).head(probabilities.size()) = probabilities;
+  }
+
+  return write(
+    _path,
+    _markov_chain.initial_state(),
+    _markov_chain.transition_matrix().template cast<double>(),
+    emissions,
+    _sparse);
+}
@@ -0,0 +1,147 @@
+#include "monte_carlo.h"
+#include "random.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+monte_carlo::monte_carlo(
+  const markov_chain<discrete_distribution>& _markov_chain,
+  thread_pool& _thread_pool
+) : m_markov_chain(_markov_chain)
+  , m_thread_pool(_thread_pool)
+{
+  /* empty */
+}
+
+monte_carlo::histograms monte_carlo::simulate(
+  const std::uint64_t _trajectories,
+  const std::uint64_t _steps,
+  const std::uint64_t _seed)
+{
+  MATE_TRACE_SCOPE("monte_carlo::simulate");
+
+  const std::uint64_t state_count = m_markov_chain.transition_matrix().rows();
+
+  std::uint64_t symbol_count = 0;
+  for (const auto& distribution : m_markov_chain.emission_distributions())
+  {
+    symbol_count = std::max<std::uint64_t>(symbol_count, distribution.probabilities().size());
+  }
+
+  // alias tables of the initial state and of every row of the transition matrix
+  m_initial_state = discrete_distribution(m_markov_chain.initial_state().transpose());
+  m_transitions.resize(state_count);
+  for (std::uint64_t i = 0; i < state_count; i++)
+  {
+    m_transitions[i] = discrete_distribution(m_markov_chain.transition_matrix().row(i).transpose());
+  }
+
+  // every worker pulls blocks of trajectories into its own histograms
+  const std::uint64_t block_count = (_trajectories + block_size - 1) / block_size;
+  const std::uint64_t worker_count = std::max<std::uint64_t>(1, std::min(m_thread_pool.thread_count(), block_count));
+  std::vector<histograms> partial(worker_count);
+  std::atomic<std::uint64_t> next_block(0);
+
+  for (auto& current : partial)
+  {
+    histograms* h = &current;
+    m_thread_pool.submit([this, h, &next_block, block_count, _trajectories, _steps, _seed, state_count, symbol_count]
+    {
+      MATE_TRACE_SCOPE("monte_carlo::worker");
+      h->reset(_steps, state_count, symbol_count);
+      for (std::uint64_t block = next_block++; block < block_count; block = next_block++)
+      {
+        math::random_stream stream(_seed, block);
+        const std::uint64_t begin = block * block_size;
+        const std::uint64_t end = std::min(begin + block_size, _trajectories);
+        simulate(begin, end, _steps, stream, *h);
+      }
+    });
+  }
+  m_thread_pool.wait();
+
+  for (std::uint64_t w = 1; w < worker_count; w++)
+  {
+    partial.front().merge(partial[w]);
+  }
+
+  return partial.front();
+}
+
+// -------------------------------------------------------------------------------------------------
+// private
+// -------------------------------------------------------------------------------------------------
+
+const std::uint64_t monte_carlo::block_size = 256;
+
+void monte_carlo::histograms::reset(
+  const std::uint64_t _steps,
+  const std::uint64_t _state_count,
+  const std::uint64_t _symbol_count)
+{
+  occupancy.setZero(_steps + 1, _state_count);
+  first_passage.setZero(_state_count, _steps + 2);
+  emissions.setZero(_steps + 1, _symbol_count);
+  trajectories = 0;
+}
+
+void monte_carlo::histograms::merge(const histograms& _histograms)
+{
+  occupancy += _histograms.occupancy;
+  first_passage += _histograms.first_passage;
+  emissions += _histograms.emissions;
+  trajectories += _histograms.trajectories;
+}
+
+void monte_carlo::simulate(
+  const std::uint64_t _begin,
+  const std::uint64_t _end,
+  const std::uint64_t _steps,
+  math::random_stream& _stream,
+  histograms& _histograms) const
+{
+  const std::vector<discrete_distribution>& distributions = m_markov_chain.emission_distributions();
+  const std::uint64_t state_count = m_transitions.size();
+
+  std::vector<bool> visited(state_count);
+
+  for (std::uint64_t trajectory = _begin; trajectory < _end; trajectory++)
+  {
+    std::fill(visited.begin(), visited.end(), false);
+
+    std::uint64_t state;
+    m_initial_state.sample(1, &state, _stream);
+    for (std::uint64_t t = 0; t <= _steps; t++)
+    {
+      _histograms.occupancy(t, state)++;
+
+      if (!visited[state])
+      {
+        visited[state] = true;
+        _histograms.first_passage(state, t)++;
+      }
+
+      std::uint64_t symbol;
+      distributions[state].sample(1, &symbol, _stream);
+      _histograms.emissions(t, symbol)++;
+
+      if (t < _steps)
+      {
+        m_transitions[state].sample(1, &state, _stream);
+      }
+    }
+
+    for (std::uint64_t s = 0; s < state_count; s++)
+    {
+      if (!visited[s]) { _histograms.first_passage(s, _steps + 1)++; }
+    }
+
+    _histograms.trajectories++;
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "discrete_distribution.h"
+#include "markov_chain.h"
+#include "thread_pool.h"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <vector>
+
+namespace math { class random_stream; }
+
+/// Monte Carlo simulation of a hidden markov model with discrete emissions. Independent state and
+/// emission trajectories are sampled on the worker threads of a thread pool and summarized into
+/// empirical histograms.
+/// Trajectories are simulated in fixed blocks, each of them drawing from its own random stream
+/// derived from the seed and the block index. The result for a given seed is therefore the same
+/// for any number of worker threads.
+class monte_carlo
+{
+public:
+  typedef Eigen::Matrix<std::uint64_t, Eigen::Dynamic, Eigen::Dynamic> count_matrix;
+
+  /// Empirical histograms of a simulation.
+  struct histograms
+  {
+    /// Number of trajectories in each state (columns) at each step (rows).
+    count_matrix occupancy;
+    /// Number of trajectories reaching each state (rows) for the first time at each step
+    /// (columns). The last column counts the trajectories which never reached the state.
+    count_matrix first_passage;
+    /// Number of trajectories emitting each symbol (columns) at each step (rows).
+    count_matrix emissions;
+    /// Number of simulated trajectories.
+    std::uint64_t trajectories;
+
+    void reset(
+      const std::uint64_t _steps,
+      const std::uint64_t _state_count,
+      const std::uint64_t _symbol_count
+    );
+    void merge(const histograms& _histograms);
+  };
+
+  /// Prepare the simulation of the given markov chain.
+  /// \param _markov_chain Markov chain to simulate.
+  /// \param _thread_pool Thread pool to simulate the trajectories with.
+  monte_carlo(const markov_chain<discrete_distribution>& _markov_chain, thread_pool& _thread_pool);
+
+  /// Simulate the given number of trajectories over the given number of steps.
+  /// \param _trajectories Number of independent trajectories.
+  /// \param _steps Number of transitions of each trajectory. Every trajectory visits
+  ///   (_steps + 1) states.
+  /// \param _seed Seed of the simulation.
+  /// \return Histograms of all trajectories.
+  histograms simulate(
+    const std::uint64_t _trajectories,
+    const std::uint64_t _steps,
+    const std::uint64_t _seed
+  );
+
+private:
+  /// Number of trajectories sharing a single random stream.
+  static const std::uint64_t block_size;
+
+  /// Simulate the trajectories [_begin,_end) and add them to the histograms.
+  /// \param _begin index of the first trajectory.
+  /// \param _end index after the last trajectory.
+  /// \param _steps Number of transitions of each trajectory.
+  /// \param _stream stream of random numbers to draw from.
+  /// \param _histograms histograms to accumulate into.
+  void simulate(
+    const std::uint64_t _begin,
+    const std::uint64_t _end,
+    const std::uint64_t _steps,
+    math::random_stream& _stream,
+    histograms& _histograms
+  ) const;
+
+  const markov_chain<discrete_distribution>& m_markov_chain;
+  thread_pool& m_thread_pool;
+
+  /// Initial state probabilities, to draw the first state of each trajectory from.
+  discrete_distribution m_initial_state;
+
+  /// Transition probabilities of each state, to draw the successor of a state from.
+  std::vector<discrete_distribution> m_transitions;
+};
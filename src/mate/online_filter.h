@@ -0,0 +1,116 @@
+#pragma once
+
+#include "markov_chain.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/// Forward filter of a hidden markov chain over a live sequence of observations. Each observation
+/// is pushed as it arrives and updates the filtered state distribution, i.e. the probability of
+/// each state given every observation so far, and the log-likelihood of the observations so far.
+/// The cost per observation is a single step of the chain, the memory is constant.
+/// \tparam chain Type of the markov chain, e.g. markov_chain<>.
+template<typename chain>
+class online_filter
+{
+public:
+  /// Start filtering with the initial state vector of the given markov chain.
+  /// \param _markov_chain markov chain to filter, which has to outlive the filter.
+  online_filter(const chain& _markov_chain);
+
+  /// Forget every observation and start over with the initial state vector.
+  void reset();
+
+  /// Push the next observation.
+  /// \param _observation next observation.
+  /// \return the log-likelihood of this observation given all previous observations.
+  double observe(const std::uint64_t _observation);
+
+  /// Push the next observations.
+  /// \param _count number of observations.
+  /// \param _observations contiguous array of observations.
+  void observe(const std::uint64_t _count, const std::uint64_t* _observations);
+
+  /// \return the probability of each state given every observation so far.
+  const Eigen::RowVectorXd& state() const { return m_state; }
+
+  /// \return the natural logarithm of the probability of every observation so far.
+  double log_likelihood() const { return m_log_likelihood; }
+
+  /// \return the number of observations so far.
+  std::uint64_t observation_count() const { return m_observation_count; }
+
+private:
+  /// Filtered markov chain.
+  const chain& m_markov_chain;
+
+  /// Probability of each state given every observation so far.
+  Eigen::RowVectorXd m_state;
+
+  /// Storage of the next state vector.
+  Eigen::RowVectorXd m_next;
+
+  /// Natural logarithm of the probability of every observation so far.
+  double m_log_likelihood;
+
+  /// Number of observations so far.
+  std::uint64_t m_observation_count;
+};
+
+// -------------------------------------------------------------------------------------------------
+// implementation
+// -------------------------------------------------------------------------------------------------
+
+template<typename chain>
+online_filter<chain>::online_filter(const chain& _markov_chain)
+  : m_markov_chain(_markov_chain)
+  , m_next(_markov_chain.initial_state().size())
+{
+  reset();
+}
+
+template<typename chain>
+void online_filter<chain>::reset()
+{
+  m_state = m_markov_chain.initial_state();
+  m_log_likelihood = 0;
+  m_observation_count = 0;
+}
+
+template<typename chain>
+double online_filter<chain>::observe(const std::uint64_t _observation)
+{
+  // the first observation is emitted from the initial state vector, every other one after a step
+  if (m_observation_count > 0)
+  {
+    markov_chain_detail::step(m_state, m_markov_chain.transition_matrix(), m_next);
+    m_state.swap(m_next);
+  }
+  m_markov_chain.emissions().emit(_observation, m_state);
+  m_observation_count++;
+
+  const double scale = m_state.sum();
+  if (scale <= 0)
+  {
+    // impossible observation, the filter stays impossible until reset
+    m_log_likelihood = -std::numeric_limits<double>::infinity();
+    return m_log_likelihood;
+  }
+  m_state /= scale;
+
+  const double log_scale = std::log(scale);
+  m_log_likelihood += log_scale;
+  return log_scale;
+}
+
+template<typename chain>
+void online_filter<chain>::observe(const std::uint64_t _count, const std::uint64_t* _observations)
+{
+  for (std::uint64_t i = 0; i < _count; i++)
+  {
+    observe(_observations[i]);
+  }
+}
@@ -0,0 +1,36 @@
+#include "packed_emissions.h"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+packed_emissions::packed_emissions(const std::vector<discrete_distribution>& _distributions)
+{
+  std::uint64_t symbol_count = 0;
+  for (const auto& distribution : _distributions)
+  {
+    symbol_count = std::max<std::uint64_t>(symbol_count, distribution.probabilities().size());
+  }
+
+  m_probabilities.setZero(symbol_count, _distributions.size());
+  m_log_probabilities.resize(symbol_count, _distributions.size());
+  for (std::uint64_t j = 0; j < _distributions.size(); j++)
+  {
+    assign(j, _distributions[j]);
+  }
+}
+
+discrete_distribution packed_emissions::state(const std::uint64_t _state) const
+{
+  return discrete_distribution(m_probabilities.col(_state));
+}
+
+void packed_emissions::assign(const std::uint64_t _state, const discrete_distribution& _distribution)
+{
+  const Eigen::VectorXd& probabilities = _distribution.probabilities();
+  m_probabilities.col(_state).setZero();
+  m_probabilities.col(_state).head(probabilities.size()) = probabilities;
+  m_log_probabilities.col(_state) = m_probabilities.col(_state).array().log();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "discrete_distribution.h"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/// Emission policy of a markov chain with discrete emissions, which packs the emission
+/// probabilities of all states into a single, contiguous matrix of symbols (rows) times states
+/// (columns) in row-major order. The probabilities of a single symbol in every state are
+/// therefore loaded with a single, vectorized read within the forward and Viterbi loops.
+/// A discrete_distribution is still available as a per-state view of the matrix.
+class packed_emissions
+{
+public:
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> table;
+
+  /// Pack the emission probabilities of the given distributions.
+  /// \param _distributions Vector of emission probability distributions. One for each state.
+  packed_emissions(const std::vector<discrete_distribution>& _distributions);
+
+  /// \return the number of states.
+  std::uint64_t state_count() const { return m_probabilities.cols(); }
+
+  /// \return the number of possible observations.
+  std::uint64_t symbol_count() const { return m_probabilities.rows(); }
+
+  /// Get the emission probability distribution of the given state.
+  /// \param _state index of the state.
+  /// \return the emission probability distribution.
+  discrete_distribution state(const std::uint64_t _state) const;
+
+  /// Replace the emission probability distribution of the given state.
+  /// \param _state index of the state.
+  /// \param _distribution new emission probability distribution.
+  void assign(const std::uint64_t _state, const discrete_distribution& _distribution);
+
+  /// Get the probability of every state to emit the given observation.
+  /// \param _observation emitted observation, less than symbol_count().
+  /// \return contiguous row of emission probabilities, one for each state.
+  table::ConstRowXpr symbol(const std::uint64_t _observation) const
+  {
+    return m_probabilities.row(_observation);
+  }
+
+  /// Multiply each element of the state vector by the probability of its state to emit the given
+  /// observation. An observation beyond the symbols cannot be emitted by any state, as with
+  /// per_state_emissions.
+  /// \param _observation emitted observation.
+  /// \param _state_vector state vector to multiply.
+  void emit(const std::uint64_t _observation, Eigen::Ref<Eigen::RowVectorXd> _state_vector) const
+  {
+    if (_observation >= symbol_count())
+    {
+      _state_vector.setZero();
+      return;
+    }
+    _state_vector.array() *= m_probabilities.row(_observation).array();
+  }
+
+  /// Add the natural logarithm of the probability of each state to emit the given observation to
+  /// the respective element of the log-space state vector. An observation beyond the symbols
+  /// cannot be emitted by any state, as with per_state_emissions.
+  /// \param _observation emitted observation.
+  /// \param _log_state_vector state vector in log-space.
+  void log_emit(const std::uint64_t _observation, Eigen::Ref<Eigen::RowVectorXd> _log_state_vector) const
+  {
+    if (_observation >= symbol_count())
+    {
+      _log_state_vector.setConstant(-std::numeric_limits<double>::infinity());
+      return;
+    }
+    _log_state_vector.array() += m_log_probabilities.row(_observation).array();
+  }
+
+  /// \return the matrix of emission probabilities.
+  const table& probabilities() const { return m_probabilities; }
+
+private:
+  /// Emission probability of each symbol (rows) in each state (columns).
+  table m_probabilities;
+
+  /// Natural logarithm of the emission probabilities.
+  table m_log_probabilities;
+};
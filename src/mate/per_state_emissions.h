@@ -0,0 +1,112 @@
+#pragma once
+
+#include "discrete_distribution.h"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/// Emission policy of a markov chain, which keeps a separate emission probability distribution for
+/// each state. Works with any kind of distribution.
+template<typename distribution>
+class per_state_emissions
+{
+public:
+  /// Define the emissions by one distribution for each state.
+  /// \param _distributions Vector of emission probability distributions. One for each state.
+  per_state_emissions(const std::vector<distribution>& _distributions)
+    : m_distributions(_distributions)
+  {
+    /* empty */
+  }
+
+  /// \return the number of states.
+  std::uint64_t state_count() const { return m_distributions.size(); }
+
+  /// Get the emission probability distribution of the given state.
+  /// \param _state index of the state.
+  /// \return the emission probability distribution.
+  const distribution& state(const std::uint64_t _state) const { return m_distributions[_state]; }
+
+  /// Replace the emission probability distribution of the given state.
+  /// \param _state index of the state.
+  /// \param _distribution new emission probability distribution.
+  void assign(const std::uint64_t _state, const distribution& _distribution)
+  {
+    m_distributions[_state] = _distribution;
+  }
+
+  /// Multiply each element of the state vector by the probability of its state to emit the given
+  /// observation.
+  /// \param _observation emitted observation.
+  /// \param _state_vector state vector to multiply.
+  void emit(const std::uint64_t _observation, Eigen::Ref<Eigen::RowVectorXd> _state_vector) const
+  {
+    Eigen::VectorXd observation(1);
+    observation[0] = static_cast<double>(_observation);
+    for (std::uint64_t j = 0; j < m_distributions.size(); j++)
+    {
+      _state_vector[j] *= m_distributions[j].probability(observation);
+    }
+  }
+
+  /// Add the natural logarithm of the probability of each state to emit the given observation to
+  /// the respective element of the log-space state vector.
+  /// \param _observation emitted observation.
+  /// \param _log_state_vector state vector in log-space.
+  void log_emit(const std::uint64_t _observation, Eigen::Ref<Eigen::RowVectorXd> _log_state_vector) const
+  {
+    Eigen::VectorXd observation(1);
+    observation[0] = static_cast<double>(_observation);
+    for (std::uint64_t j = 0; j < m_distributions.size(); j++)
+    {
+      _log_state_vector[j] += m_distributions[j].log_probability(observation);
+    }
+  }
+
+  /// \return the vector of emission probability distributions.
+  const std::vector<distribution>& distributions() const { return m_distributions; }
+
+  /// Modify the vector of emission probability distributions.
+  /// \return reference to the vector of emission probability distributions.
+  std::vector<distribution>& distributions() { return m_distributions; }
+
+private:
+  /// Vector of emission probability distributions. One for each state.
+  std::vector<distribution> m_distributions;
+};
+
+// -------------------------------------------------------------------------------------------------
+// implementation
+// -------------------------------------------------------------------------------------------------
+
+/// Emissions of discrete distributions read the probability vectors and the cached log tables
+/// directly, without a temporary observation vector or a bounds check in each distribution. An
+/// observation beyond the symbols of a distribution cannot be emitted by its state.
+template<>
+inline void per_state_emissions<discrete_distribution>::emit(
+  const std::uint64_t _observation,
+  Eigen::Ref<Eigen::RowVectorXd> _state_vector) const
+{
+  for (std::uint64_t j = 0; j < m_distributions.size(); j++)
+  {
+    const Eigen::VectorXd& probabilities = m_distributions[j].probabilities();
+    _state_vector[j] *= (_observation < static_cast<std::uint64_t>(probabilities.size())) ? probabilities[_observation] : 0.0;
+  }
+}
+
+template<>
+inline void per_state_emissions<discrete_distribution>::log_emit(
+  const std::uint64_t _observation,
+  Eigen::Ref<Eigen::RowVectorXd> _log_state_vector) const
+{
+  for (std::uint64_t j = 0; j < m_distributions.size(); j++)
+  {
+    const Eigen::VectorXd& log_probabilities = m_distributions[j].log_probabilities();
+    _log_state_vector[j] += (_observation < static_cast<std::uint64_t>(log_probabilities.size()))
+      ? log_probabilities[_observation]
+      : -std::numeric_limits<double>::infinity();
+  }
+}
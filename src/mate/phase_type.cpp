@@ -0,0 +1,137 @@
+#include "phase_type.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+/// Build a chain of phases with a common rate, entered in the first or second phase.
+/// \param _phases number of phases.
+/// \param _rate rate of each phase.
+/// \param _skip probability to skip the first phase.
+phase_type erlang_chain(const std::uint64_t _phases, const double _rate, const double _skip)
+{
+  Eigen::RowVectorXd initial_phases = Eigen::RowVectorXd::Zero(_phases);
+  Eigen::MatrixXd sub_generator = Eigen::MatrixXd::Zero(_phases, _phases);
+
+  initial_phases[0] = 1 - _skip;
+  if (_phases > 1) { initial_phases[1] = _skip; }
+
+  for (std::uint64_t i = 0; i < _phases; i++)
+  {
+    sub_generator(i, i) = -_rate;
+    if (i + 1 < _phases) { sub_generator(i, i + 1) = _rate; }
+  }
+
+  return phase_type(initial_phases, sub_generator);
+}
+
+}; // namespace
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+phase_type::phase_type(const Eigen::RowVectorXd& _initial_phases, const Eigen::MatrixXd& _sub_generator)
+  : m_initial_phases(_initial_phases)
+  , m_sub_generator(_sub_generator)
+{
+  /* empty */
+}
+
+phase_type phase_type::fit(const double _mean, const double _scv, const std::uint64_t _max_phases)
+{
+  const std::uint64_t max_phases = std::max<std::uint64_t>(_max_phases, 1);
+
+  if (max_phases == 1 || _scv == 1)
+  {
+    return erlang_chain(1, 1 / _mean, 0);
+  }
+
+  if (_scv > 1)
+  {
+    // hyperexponential distribution with balanced means p1/l1 = p2/l2
+    const double p = 0.5 * (1 + std::sqrt((_scv - 1) / (_scv + 1)));
+    Eigen::RowVectorXd initial_phases(2);
+    initial_phases << p, 1 - p;
+    Eigen::MatrixXd sub_generator = Eigen::MatrixXd::Zero(2, 2);
+    sub_generator(0, 0) = -2 * p / _mean;
+    sub_generator(1, 1) = -2 * (1 - p) / _mean;
+    return phase_type(initial_phases, sub_generator);
+  }
+
+  const std::uint64_t k = static_cast<std::uint64_t>(std::ceil(1 / std::max(_scv, 1.0e-12)));
+  if (k > max_phases)
+  {
+    // the smallest scv of max_phases phases is 1/max_phases, an erlang distribution
+    return erlang_chain(max_phases, max_phases / _mean, 0);
+  }
+
+  // mixture of erlang(k-1) and erlang(k) with probability p of k-1 phases
+  const double kd = static_cast<double>(k);
+  const double p = (kd * _scv - std::sqrt(std::max(kd * (1 + _scv) - kd * kd * _scv, 0.0))) / (1 + _scv);
+  return erlang_chain(k, (kd - p) / _mean, p);
+}
+
+phase_type phase_type::fit(
+  const std::function<double(double)>& _hazard_rate,
+  const std::uint64_t _max_phases,
+  const double _step,
+  const double _horizon)
+{
+  MATE_TRACE_SCOPE("phase_type::fit");
+
+  double mean;
+  double scv;
+  moments(_hazard_rate, mean, scv, _step, _horizon);
+  return fit(mean, scv, _max_phases);
+}
+
+void phase_type::moments(
+  const std::function<double(double)>& _hazard_rate,
+  double& _mean,
+  double& _scv,
+  const double _step,
+  const double _horizon)
+{
+  // E[X] = integral of S(t), E[X^2] = 2 * integral of t * S(t) with the survival function S
+  double survival = 1;
+  double first = 0;
+  double second = 0;
+  for (double t = 0; t < _horizon && survival > 1.0e-15; t += _step)
+  {
+    const double midpoint = t + _step / 2;
+    const double rate = _hazard_rate(midpoint);
+    // an activity certain to fire within the step ends the distribution, as in the proxel solver
+    const double next = (rate * _step < 1) ? survival * std::exp(-rate * _step) : 0;
+    first += (survival + next) / 2 * _step;
+    second += 2 * midpoint * (survival + next) / 2 * _step;
+    survival = next;
+  }
+
+  _mean = first;
+  _scv = (first > 0) ? second / (first * first) - 1 : 1;
+}
+
+Eigen::VectorXd phase_type::exit_rates() const
+{
+  return -m_sub_generator.rowwise().sum();
+}
+
+double phase_type::mean() const
+{
+  // E[X] = alpha * (-S)^-1 * 1
+  const Eigen::MatrixXd inverse = (-m_sub_generator).inverse();
+  return (m_initial_phases * inverse).sum();
+}
+
+double phase_type::scv() const
+{
+  // E[X^2] = 2 * alpha * (-S)^-2 * 1
+  const Eigen::MatrixXd inverse = (-m_sub_generator).inverse();
+  const Eigen::RowVectorXd once = m_initial_phases * inverse;
+  const double mean = once.sum();
+  const double second = 2 * (once * inverse).sum();
+  return second / (mean * mean) - 1;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <functional>
+
+/// An acyclic phase-type distribution: the time until absorption of a continuous time markov chain
+/// of transient phases, entered with the initial phase probabilities and left with the exit rate of
+/// each phase. A non-exponential activity of a model is replaced by its phases, which turns the
+/// whole model into a CTMC that is solved by a markov_chain in place of a proxel simulation.
+/// Distributions are fitted to the first two moments of a hazard rate function:
+/// - squared coefficient of variation >= 1: hyperexponential distribution of two phases with
+///   balanced means.
+/// - squared coefficient of variation < 1: mixture of two erlang distributions of k-1 and k phases
+///   with a common rate, where k = ceil(1/scv). If k exceeds the maximum number of phases, an
+///   erlang distribution of the maximum number of phases matches the mean and approximates the
+///   variance as close as possible.
+/// The maximum number of phases therefore trades the accuracy of distributions with a small
+/// variance, e.g. a uniform or deterministic delay, for the size of the CTMC. Beyond k phases the
+/// fit does not improve anymore, as only the first two moments are matched.
+class phase_type
+{
+public:
+  /// Define the distribution by its phases.
+  /// \param _initial_phases probability to start in each phase.
+  /// \param _sub_generator matrix of the transition rates between the transient phases. The
+  ///   diagonal holds the negative total rate of leaving each phase, including the exit rate.
+  phase_type(const Eigen::RowVectorXd& _initial_phases, const Eigen::MatrixXd& _sub_generator);
+
+  /// Fit a distribution to the mean and the squared coefficient of variation.
+  /// \param _mean mean.
+  /// \param _scv squared coefficient of variation, variance / mean^2.
+  /// \param _max_phases maximum number of phases.
+  /// \return the fitted distribution.
+  static phase_type fit(const double _mean, const double _scv, const std::uint64_t _max_phases);
+
+  /// Fit a distribution to the moments of a hazard rate function, which are integrated
+  /// numerically from its survival function exp(-integral of the hazard rate) until the survival
+  /// probability is negligible. The hazard rate is evaluated in the middle of each step, so
+  /// singularities at the bounds, e.g. of a uniform distribution, are never hit.
+  /// \param _hazard_rate hazard rate function of the age.
+  /// \param _max_phases maximum number of phases.
+  /// \param _step step size of the integration.
+  /// \param _horizon maximum age of the integration.
+  /// \return the fitted distribution.
+  static phase_type fit(
+    const std::function<double(double)>& _hazard_rate,
+    const std::uint64_t _max_phases,
+    const double _step = 1.0e-3,
+    const double _horizon = 1.0e5
+  );
+
+  /// Integrate the mean and the squared coefficient of variation of a hazard rate function.
+  /// \param _hazard_rate hazard rate function of the age.
+  /// \param _mean resulting mean.
+  /// \param _scv resulting squared coefficient of variation.
+  /// \param _step step size of the integration.
+  /// \param _horizon maximum age of the integration.
+  static void moments(
+    const std::function<double(double)>& _hazard_rate,
+    double& _mean,
+    double& _scv,
+    const double _step = 1.0e-3,
+    const double _horizon = 1.0e5
+  );
+
+  /// \return the number of phases.
+  std::uint64_t phase_count() const { return m_initial_phases.size(); }
+
+  /// \return the probability to start in each phase.
+  const Eigen::RowVectorXd& initial_phases() const { return m_initial_phases; }
+
+  /// \return the matrix of transition rates between the transient phases.
+  const Eigen::MatrixXd& sub_generator() const { return m_sub_generator; }
+
+  /// \return the rate of leaving the distribution from each phase.
+  Eigen::VectorXd exit_rates() const;
+
+  /// \return the mean of the distribution.
+  double mean() const;
+
+  /// \return the squared coefficient of variation of the distribution.
+  double scv() const;
+
+private:
+  /// Probability to start in each phase.
+  Eigen::RowVectorXd m_initial_phases;
+
+  /// Transition rates between the transient phases.
+  Eigen::MatrixXd m_sub_generator;
+};
@@ -0,0 +1,144 @@
+#include "philox.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+
+namespace math {
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+void philox::discard(std::uint64_t _count)
+{
+  // outputs left in the current block
+  const std::uint64_t buffered = 2 - m_index;
+  if (_count <= buffered)
+  {
+    m_index += static_cast<std::uint32_t>(_count);
+    return;
+  }
+  _count -= buffered;
+
+  // skip whole blocks by moving the counter, then partially consume the next block
+  m_counter += _count / 2;
+  m_index = 2;
+  if (_count % 2 == 1)
+  {
+    block(m_counter++, m_buffer);
+    m_index = 1;
+  }
+}
+
+void philox::generate(std::uint64_t* _result, std::uint64_t _count)
+{
+  // drain the current block first to keep the position within the stream consistent
+  while (_count > 0 && m_index < 2)
+  {
+    *_result++ = m_buffer[m_index++];
+    _count--;
+  }
+
+  // independent blocks are evaluated side by side in lanes to allow for vectorization
+  const std::uint64_t lanes = 8;
+  const std::uint32_t stream_0 = static_cast<std::uint32_t>(m_stream);
+  const std::uint32_t stream_1 = static_cast<std::uint32_t>(m_stream >> 32);
+
+  while (_count >= 2 * lanes)
+  {
+    std::uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+    for (std::uint64_t l = 0; l < lanes; l++)
+    {
+      c0[l] = static_cast<std::uint32_t>(m_counter + l);
+      c1[l] = static_cast<std::uint32_t>((m_counter + l) >> 32);
+      c2[l] = stream_0;
+      c3[l] = stream_1;
+    }
+
+    std::uint32_t key_0 = static_cast<std::uint32_t>(m_key);
+    std::uint32_t key_1 = static_cast<std::uint32_t>(m_key >> 32);
+    for (int r = 0; r < philox_detail::rounds; r++)
+    {
+      for (std::uint64_t l = 0; l < lanes; l++)
+      {
+        const std::uint64_t product_0 = static_cast<std::uint64_t>(philox_detail::multiplier_0) * c0[l];
+        const std::uint64_t product_1 = static_cast<std::uint64_t>(philox_detail::multiplier_1) * c2[l];
+        c0[l] = static_cast<std::uint32_t>(product_1 >> 32) ^ c1[l] ^ key_0;
+        c2[l] = static_cast<std::uint32_t>(product_0 >> 32) ^ c3[l] ^ key_1;
+        c1[l] = static_cast<std::uint32_t>(product_1);
+        c3[l] = static_cast<std::uint32_t>(product_0);
+      }
+      key_0 += philox_detail::weyl_0;
+      key_1 += philox_detail::weyl_1;
+    }
+
+    for (std::uint64_t l = 0; l < lanes; l++)
+    {
+      _result[2 * l] = c0[l] | (static_cast<std::uint64_t>(c1[l]) << 32);
+      _result[2 * l + 1] = c2[l] | (static_cast<std::uint64_t>(c3[l]) << 32);
+    }
+
+    m_counter += lanes;
+    _result += 2 * lanes;
+    _count -= 2 * lanes;
+  }
+
+  while (_count > 0)
+  {
+    *_result++ = (*this)();
+    _count--;
+  }
+}
+
+void philox::fill_uniform(double* _result, const std::uint64_t _count)
+{
+  // the raw bits are generated into a chunk on the stack and converted afterwards
+  const std::uint64_t chunk = 256;
+  std::uint64_t bits[chunk];
+
+  for (std::uint64_t i = 0; i < _count; i += chunk)
+  {
+    const std::uint64_t n = std::min(chunk, _count - i);
+    generate(bits, n);
+    for (std::uint64_t j = 0; j < n; j++)
+    {
+      _result[i + j] = to_uniform(bits[j]);
+    }
+  }
+}
+
+void philox::fill_normal(double* _result, const std::uint64_t _count)
+{
+  // pairs of uniform numbers are transformed chunk by chunk with vectorized array expressions
+  const std::uint64_t chunk = 128;
+  const double two_pi = 6.283185307179586476925286766559;
+  typedef Eigen::Array<double, chunk, 1> chunk_array;
+
+  chunk_array radius;
+  chunk_array angle;
+  double uniform[2 * chunk];
+
+  for (std::uint64_t i = 0; i < _count; i += 2 * chunk)
+  {
+    const std::uint64_t n = std::min(2 * chunk, _count - i);
+    const std::uint64_t pairs = (n + 1) / 2;
+
+    fill_uniform(uniform, 2 * pairs);
+    for (std::uint64_t j = 0; j < pairs; j++)
+    {
+      // (0,1] instead of [0,1) to keep the logarithm finite
+      radius[j] = 1.0 - uniform[2 * j];
+      angle[j] = uniform[2 * j + 1];
+    }
+
+    radius.head(pairs) = (-2.0 * radius.head(pairs).log()).sqrt();
+    angle.head(pairs) *= two_pi;
+
+    Eigen::Map<Eigen::ArrayXd> result(_result + i, n);
+    result.head(n / 2) = radius.head(n / 2) * angle.head(n / 2).cos();
+    result.tail(pairs) = radius.head(pairs) * angle.head(pairs).sin();
+  }
+}
+
+}; // namespace math
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace math {
+
+/// Counter-based pseudo random number generator Philox4x32-10 as described in "Parallel Random
+/// Numbers: As Easy as 1, 2, 3" by Salmon et al. (2011).
+/// Every output is a pure function of the key (seed), the stream index and the position within
+/// the stream. Creating an independent stream and jumping ahead within a stream are therefore
+/// O(1) operations, and the generator holds no state which has to be shared between threads.
+/// Satisfies the requirements of a UniformRandomBitGenerator.
+class philox
+{
+public:
+  typedef std::uint64_t result_type;
+
+  /// Create the generator for the given stream of the given seed.
+  /// \param _seed key of the generator.
+  /// \param _stream index of the stream.
+  philox(const std::uint64_t _seed = 0, const std::uint64_t _stream = 0)
+    : m_key(_seed)
+    , m_stream(_stream)
+    , m_counter(0)
+    , m_index(2)
+  {
+    /* empty */
+  }
+
+  static result_type min() { return 0; }
+  static result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  /// Generate the next 64 random bits of the stream.
+  result_type operator()()
+  {
+    if (m_index == 2)
+    {
+      block(m_counter++, m_buffer);
+      m_index = 0;
+    }
+    return m_buffer[m_index++];
+  }
+
+  /// Advance the position within the stream as if operator() was called the given number of
+  /// times.
+  /// \param _count number of outputs to skip.
+  void discard(std::uint64_t _count);
+
+  /// Create an independent stream with the same seed.
+  /// \param _stream index of the new stream.
+  /// \return generator positioned at the start of the new stream.
+  philox split(const std::uint64_t _stream) const { return philox(m_key, _stream); }
+
+  /// Generate the given number of successive outputs of the stream.
+  /// \param _result destination of the outputs.
+  /// \param _count number of outputs.
+  void generate(std::uint64_t* _result, std::uint64_t _count);
+
+  /// Fill the destination with uniformly distributed random numbers in [0,1).
+  /// \param _result destination of the random numbers.
+  /// \param _count number of random numbers.
+  void fill_uniform(double* _result, const std::uint64_t _count);
+
+  /// Fill the destination with normally distributed random numbers with (_mean = 0) and
+  /// (_variance = 1) by the Box-Muller transform.
+  /// \param _result destination of the random numbers.
+  /// \param _count number of random numbers.
+  void fill_normal(double* _result, const std::uint64_t _count);
+
+  /// Convert 64 random bits into a uniformly distributed number in [0,1) with 53 bits of
+  /// precision.
+  static double to_uniform(const std::uint64_t _bits)
+  {
+    return static_cast<double>(_bits >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+private:
+  /// Compute the 128 output bits of the given counter.
+  /// \param _counter position of the block within the stream.
+  /// \param _result the two 64 bit outputs of the block.
+  void block(const std::uint64_t _counter, std::uint64_t* _result) const;
+
+  /// Key of the generator.
+  std::uint64_t m_key;
+  /// Index of the stream, the upper half of the 128 bit counter.
+  std::uint64_t m_stream;
+  /// Position of the next block within the stream, the lower half of the 128 bit counter.
+  std::uint64_t m_counter;
+  /// Outputs of the current block.
+  std::uint64_t m_buffer[2];
+  /// Index of the next unused output of the current block. 2 if the block is exhausted.
+  std::uint32_t m_index;
+};
+
+// -------------------------------------------------------------------------------------------------
+// implementation
+// -------------------------------------------------------------------------------------------------
+
+namespace philox_detail {
+
+const std::uint32_t multiplier_0 = 0xD2511F53;
+const std::uint32_t multiplier_1 = 0xCD9E8D57;
+const std::uint32_t weyl_0 = 0x9E3779B9;
+const std::uint32_t weyl_1 = 0xBB67AE85;
+const int rounds = 10;
+
+/// A single round of the Philox4x32 bijection.
+inline void round(std::uint32_t* _counter, const std::uint32_t _key_0, const std::uint32_t _key_1)
+{
+  const std::uint64_t product_0 = static_cast<std::uint64_t>(multiplier_0) * _counter[0];
+  const std::uint64_t product_1 = static_cast<std::uint64_t>(multiplier_1) * _counter[2];
+  const std::uint32_t c1 = _counter[1];
+  const std::uint32_t c3 = _counter[3];
+  _counter[0] = static_cast<std::uint32_t>(product_1 >> 32) ^ c1 ^ _key_0;
+  _counter[1] = static_cast<std::uint32_t>(product_1);
+  _counter[2] = static_cast<std::uint32_t>(product_0 >> 32) ^ c3 ^ _key_1;
+  _counter[3] = static_cast<std::uint32_t>(product_0);
+}
+
+}; // namespace philox_detail
+
+inline void philox::block(const std::uint64_t _counter, std::uint64_t* _result) const
+{
+  std::uint32_t counter[4] = {
+    static_cast<std::uint32_t>(_counter), static_cast<std::uint32_t>(_counter >> 32),
+    static_cast<std::uint32_t>(m_stream), static_cast<std::uint32_t>(m_stream >> 32)
+  };
+  std::uint32_t key_0 = static_cast<std::uint32_t>(m_key);
+  std::uint32_t key_1 = static_cast<std::uint32_t>(m_key >> 32);
+
+  for (int r = 0; r < philox_detail::rounds; r++)
+  {
+    philox_detail::round(counter, key_0, key_1);
+    key_0 += philox_detail::weyl_0;
+    key_1 += philox_detail::weyl_1;
+  }
+
+  _result[0] = counter[0] | (static_cast<std::uint64_t>(counter[1]) << 32);
+  _result[1] = counter[2] | (static_cast<std::uint64_t>(counter[3]) << 32);
+}
+
+}; // namespace math
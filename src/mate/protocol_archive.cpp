@@ -0,0 +1,330 @@
+#include "protocol_archive.h"
+#include "protocol_loader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+/// Number of bits per symbol. A power of two, so that no symbol spans two words.
+std::uint32_t bits_per_symbol(const std::uint64_t _symbol_count)
+{
+  std::uint32_t bits = 1;
+  while ((std::uint64_t(1) << bits) < _symbol_count) { bits *= 2; }
+  return bits;
+}
+
+/// Whether the time matches the expected time of the next entry of a block.
+bool matches(const double _time, const double _expected)
+{
+  return std::abs(_time - _expected) <= 1.0e-9 * std::max(1.0, std::abs(_expected));
+}
+
+}; // namespace
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+protocol_archive_writer::protocol_archive_writer(
+  const std::string& _path,
+  const std::uint64_t _block_size,
+  const bool _summaries
+) : m_file(_path.c_str(), std::ios::binary | std::ios::trunc)
+  , m_block_size(std::max<std::uint64_t>(_block_size, 1))
+  , m_counts(map_string_to_order.size(), 0)
+  , m_last_time(-HUGE_VAL)
+{
+  std::memcpy(m_header.magic, protocol_archive_format::magic, sizeof(m_header.magic));
+  m_header.version = protocol_archive_format::version;
+  m_header.symbol_count = static_cast<std::uint32_t>(map_string_to_order.size());
+  m_header.bits_per_symbol = bits_per_symbol(m_header.symbol_count);
+  m_header.summaries = _summaries ? 1 : 0;
+  m_header.entry_count = 0;
+  m_header.block_count = 0;
+  m_header.index_offset = 0;
+
+  std::memset(&m_block, 0, sizeof(m_block));
+  m_words.reserve((m_block_size * m_header.bits_per_symbol + 63) / 64);
+
+  if (!m_file.is_open())
+  {
+    std::cout << "Archive " << _path << " could not be created." << std::endl;
+    return;
+  }
+
+  // placeholder, the header is complete after close()
+  m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+}
+
+protocol_archive_writer::~protocol_archive_writer()
+{
+  close();
+}
+
+bool protocol_archive_writer::add(const double _time, const order _order)
+{
+  if (!m_file.is_open()) { return false; }
+
+  if (!(_time > m_last_time))
+  {
+    std::cout << "Protocol entry at " << _time << " must be after " << m_last_time << "." << std::endl;
+    return false;
+  }
+
+  // start a new block if the block is full or the spacing in time changes
+  if (m_block.entry_count == m_block_size
+    || (m_block.entry_count >= 2 && !matches(_time, m_block.first_time + m_block.entry_count * m_block.time_step)))
+  {
+    flush();
+  }
+
+  if (m_block.entry_count == 0)
+  {
+    m_block.first_time = _time;
+    m_block.time_step = 0;
+    m_block.first_entry = m_header.entry_count;
+  }
+  else if (m_block.entry_count == 1)
+  {
+    m_block.time_step = _time - m_block.first_time;
+  }
+
+  const std::uint64_t symbol = static_cast<std::uint64_t>(_order);
+  const std::uint64_t position = m_block.entry_count * m_header.bits_per_symbol;
+  if (position % 64 == 0) { m_words.push_back(0); }
+  m_words.back() |= symbol << (position % 64);
+  m_counts[symbol]++;
+
+  m_block.entry_count++;
+  m_header.entry_count++;
+  m_last_time = _time;
+  return true;
+}
+
+bool protocol_archive_writer::close()
+{
+  if (!m_file.is_open()) { return false; }
+
+  flush();
+
+  m_header.index_offset = static_cast<std::uint64_t>(m_file.tellp());
+  m_file.write(reinterpret_cast<const char*>(m_index.data()), m_index.size() * sizeof(std::uint64_t));
+  m_file.seekp(0);
+  m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+
+  const bool result = static_cast<bool>(m_file);
+  m_file.close();
+  return result;
+}
+
+bool protocol_archive_writer::convert(
+  const std::string& _text_path,
+  const std::string& _archive_path,
+  const std::uint64_t _block_size,
+  const bool _summaries)
+{
+  mapped_file text(_text_path);
+  protocol_archive_writer writer(_archive_path, _block_size, _summaries);
+  if (!text.is_open() || !writer.is_open()) { return false; }
+
+  const char* line = text.data();
+  const char* end = text.data() + text.size();
+  std::vector<order> entry;
+  while (line < end)
+  {
+    const char* line_end = static_cast<const char*>(std::memchr(line, '\n', end - line));
+    line_end = (line_end == nullptr) ? end : line_end + 1;
+
+    // the symbol is decoded by the parser of the text format, the time is converted separately
+    entry.clear();
+    if (protocol_loader::parse(line, line_end, entry) != line_end) { break; } // error
+
+    char time[64] = { 0 };
+    const char* token = line;
+    while (*token == ' ' || *token == '\t') { token++; }
+    std::memcpy(time, token, std::min<std::uint64_t>(line_end - token, sizeof(time) - 1));
+    if (!writer.add(std::strtod(time, nullptr), entry[0])) { return false; }
+
+    line = line_end;
+  }
+
+  return writer.close() && line == end;
+}
+
+protocol_archive::protocol_archive(const std::string& _path)
+  : m_file(_path)
+  , m_header(nullptr)
+  , m_words(nullptr)
+  , m_index(nullptr)
+  , m_record_size(0)
+{
+  if (!m_file.is_open() || m_file.size() < sizeof(protocol_archive_format::header)) { return; }
+
+  const protocol_archive_format::header* header = reinterpret_cast<const protocol_archive_format::header*>(m_file.data());
+  if (std::memcmp(header->magic, protocol_archive_format::magic, sizeof(header->magic)) != 0
+    || header->version != protocol_archive_format::version)
+  {
+    std::cout << "Archive " << _path << " is not a protocol archive of version " << protocol_archive_format::version << "." << std::endl;
+    return;
+  }
+
+  // the symbol count is 32 bit, the record size cannot overflow
+  m_record_size = sizeof(protocol_archive_format::block) + (header->summaries ? header->symbol_count * sizeof(std::uint64_t) : 0);
+  m_words = reinterpret_cast<const std::uint64_t*>(m_file.data() + sizeof(protocol_archive_format::header));
+  m_index = m_file.data() + header->index_offset;
+  if (!valid(*header))
+  {
+    std::cout << "Archive " << _path << " is truncated or corrupted." << std::endl;
+    m_words = nullptr;
+    m_index = nullptr;
+    return;
+  }
+
+  m_header = header;
+}
+
+std::uint64_t protocol_archive::read(const double _begin_time, const double _end_time, std::vector<order>& _protocol) const
+{
+  if (!is_open()) { return 0; }
+
+  const std::uint64_t size = _protocol.size();
+  for (std::uint64_t b = find(_begin_time); b < block_count() && block(b).first_time < _end_time; b++)
+  {
+    const protocol_archive_format::block& current = block(b);
+    const std::uint64_t last = lower_bound(current, _end_time);
+    for (std::uint64_t i = lower_bound(current, _begin_time); i < last; i++)
+    {
+      _protocol.push_back(static_cast<order>(symbol(current, i)));
+    }
+  }
+
+  return _protocol.size() - size;
+}
+
+std::vector<std::uint64_t> protocol_archive::count(const double _begin_time, const double _end_time) const
+{
+  if (!is_open()) { return std::vector<std::uint64_t>(); }
+
+  std::vector<std::uint64_t> result(m_header->symbol_count, 0);
+  for (std::uint64_t b = find(_begin_time); b < block_count() && block(b).first_time < _end_time; b++)
+  {
+    const protocol_archive_format::block& current = block(b);
+    const std::uint64_t first = lower_bound(current, _begin_time);
+    const std::uint64_t last = lower_bound(current, _end_time);
+
+    if (m_header->summaries && first == 0 && last == current.entry_count)
+    {
+      const std::uint64_t* counts = block_counts(b);
+      for (std::uint64_t s = 0; s < result.size(); s++) { result[s] += counts[s]; }
+      continue;
+    }
+
+    // packed symbols are not validated on opening, a corrupted one must not be counted
+    for (std::uint64_t i = first; i < last; i++)
+    {
+      const std::uint64_t s = symbol(current, i);
+      if (s < result.size()) { result[s]++; }
+    }
+  }
+
+  return result;
+}
+
+// -------------------------------------------------------------------------------------------------
+// private
+// -------------------------------------------------------------------------------------------------
+
+void protocol_archive_writer::flush()
+{
+  if (m_block.entry_count == 0) { return; }
+
+  m_block.word_offset = (static_cast<std::uint64_t>(m_file.tellp()) - sizeof(m_header)) / sizeof(std::uint64_t);
+  m_file.write(reinterpret_cast<const char*>(m_words.data()), m_words.size() * sizeof(std::uint64_t));
+
+  const std::uint64_t* record = reinterpret_cast<const std::uint64_t*>(&m_block);
+  m_index.insert(m_index.end(), record, record + sizeof(m_block) / sizeof(std::uint64_t));
+  if (m_header.summaries) { m_index.insert(m_index.end(), m_counts.begin(), m_counts.end()); }
+  m_header.block_count++;
+
+  std::memset(&m_block, 0, sizeof(m_block));
+  std::fill(m_counts.begin(), m_counts.end(), 0);
+  m_words.clear();
+}
+
+bool protocol_archive::valid(const protocol_archive_format::header& _header) const
+{
+  const std::uint64_t size = m_file.size();
+  const std::uint64_t bits = _header.bits_per_symbol;
+  if (_header.symbol_count == 0 || bits != bits_per_symbol(_header.symbol_count)) { return false; }
+
+  // the index follows the packed symbols and is read in words
+  const std::uint64_t header_size = sizeof(protocol_archive_format::header);
+  if (_header.index_offset < header_size || _header.index_offset > size || _header.index_offset % sizeof(std::uint64_t) != 0) { return false; }
+  if (_header.block_count > (size - _header.index_offset) / m_record_size) { return false; }
+
+  const std::uint64_t word_count = (_header.index_offset - header_size) / sizeof(std::uint64_t);
+  std::uint64_t entries = 0;
+  double last_time = -HUGE_VAL;
+  for (std::uint64_t b = 0; b < _header.block_count; b++)
+  {
+    const protocol_archive_format::block& current = block(b);
+
+    // blocks are consecutive and ordered in time, with finite times, as lower_bound() relies on
+    if (current.entry_count == 0 || current.first_entry != entries || current.entry_count > _header.entry_count - entries
+      || !std::isfinite(current.first_time) || !std::isfinite(current.time_step)
+      || current.time_step < 0 || current.first_time < last_time)
+    {
+      return false;
+    }
+
+    // the packed symbols of the block lie within the words before the index, without overflowing
+    if (current.entry_count > std::numeric_limits<std::uint64_t>::max() / bits) { return false; }
+    const std::uint64_t words = (current.entry_count * bits + 63) / 64;
+    if (current.word_offset > word_count || words > word_count - current.word_offset) { return false; }
+
+    entries += current.entry_count;
+    last_time = current.first_time;
+  }
+
+  return entries == _header.entry_count;
+}
+
+std::uint64_t protocol_archive::find(const double _time) const
+{
+  // last block starting at or before the given time
+  std::uint64_t first = 0;
+  std::uint64_t last = block_count();
+  while (first < last)
+  {
+    const std::uint64_t middle = first + (last - first) / 2;
+    if (block(middle).first_time <= _time) { first = middle + 1; } else { last = middle; }
+  }
+  return (first > 0) ? first - 1 : 0;
+}
+
+std::uint64_t protocol_archive::lower_bound(const protocol_archive_format::block& _block, const double _time)
+{
+  if (_time <= _block.first_time) { return 0; }
+  if (_block.time_step <= 0) { return _block.entry_count; }
+
+  // estimate by the spacing, then correct the rounding
+  std::uint64_t result = static_cast<std::uint64_t>(std::min<double>(
+    std::ceil((_time - _block.first_time) / _block.time_step),
+    static_cast<double>(_block.entry_count)));
+  while (result > 0 && _block.first_time + (result - 1) * _block.time_step >= _time) { result--; }
+  while (result < _block.entry_count && _block.first_time + result * _block.time_step < _time) { result++; }
+  return result;
+}
+
+std::uint64_t protocol_archive::symbol(const protocol_archive_format::block& _block, const std::uint64_t _entry) const
+{
+  const std::uint64_t bits = m_header->bits_per_symbol;
+  const std::uint64_t position = _entry * bits;
+  const std::uint64_t mask = (bits == 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << bits) - 1);
+  return (m_words[_block.word_offset + position / 64] >> (position % 64)) & mask;
+}
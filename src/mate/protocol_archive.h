@@ -0,0 +1,195 @@
+#pragma once
+
+#include "enum_order.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// Layout of the binary protocol archive. All values are stored in the byte order of the machine
+/// which wrote the archive.
+/// - header
+/// - packed symbols of every block, each block starting on a new 64 bit word
+/// - block index: one block record per block, each followed by the number of occurrences of
+///   every symbol within the block (if the archive has summaries)
+/// Within a block, the protocol entries are equally spaced in time, so the time of every entry
+/// follows from its index. A new block is started whenever the spacing changes, e.g. at a gap
+/// between two shifts, or the block is full.
+namespace protocol_archive_format {
+
+const char magic[4] = { 'M', 'P', 'R', 'A' };
+const std::uint32_t version = 1;
+
+struct header
+{
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t bits_per_symbol;
+  std::uint32_t symbol_count;
+  std::uint64_t summaries;   ///< whether the block records are followed by the symbol counts
+  std::uint64_t entry_count;
+  std::uint64_t block_count;
+  std::uint64_t index_offset; ///< byte offset of the block index
+};
+
+struct block
+{
+  double first_time;         ///< time of the first entry
+  double time_step;          ///< time between two entries, zero for a block of a single entry
+  std::uint64_t first_entry; ///< index of the first entry within the whole protocol
+  std::uint64_t entry_count;
+  std::uint64_t word_offset; ///< offset of the packed symbols in 64 bit words from the header
+};
+
+}; // namespace protocol_archive_format
+
+/// Writer of a binary protocol archive. Protocol entries are added in order of time.
+class protocol_archive_writer
+{
+public:
+  /// Create the archive. Check is_open() for success.
+  /// \param _path path of the archive.
+  /// \param _block_size maximum number of entries per block, the granularity of a seek.
+  /// \param _summaries whether to store the number of occurrences of each symbol per block.
+  protocol_archive_writer(
+    const std::string& _path,
+    const std::uint64_t _block_size = 4096,
+    const bool _summaries = true
+  );
+
+  /// Close the archive, if not done yet.
+  ~protocol_archive_writer();
+
+  /// \return whether the archive could be created.
+  bool is_open() const { return m_file.is_open(); }
+
+  /// Add the next protocol entry.
+  /// \param _time time of the entry, greater than the time of the previous entry.
+  /// \param _order order of the entry.
+  /// \return whether the entry has been added.
+  bool add(const double _time, const order _order);
+
+  /// Write the block index and the header.
+  /// \return whether the archive has been written successfully.
+  bool close();
+
+  /// Convert a protocol of the text format of protocol_loader into a binary archive.
+  /// \param _text_path path of the text protocol.
+  /// \param _archive_path path of the archive.
+  /// \param _block_size maximum number of entries per block.
+  /// \param _summaries whether to store the number of occurrences of each symbol per block.
+  /// \return whether the whole protocol has been converted.
+  static bool convert(
+    const std::string& _text_path,
+    const std::string& _archive_path,
+    const std::uint64_t _block_size = 4096,
+    const bool _summaries = true
+  );
+
+private:
+  /// Write the symbols of the current block and record it in the block index.
+  void flush();
+
+  /// Archive file.
+  std::ofstream m_file;
+
+  /// Header of the archive.
+  protocol_archive_format::header m_header;
+
+  /// Maximum number of entries per block.
+  std::uint64_t m_block_size;
+
+  /// Block records and symbol counts of the written blocks.
+  std::vector<std::uint64_t> m_index;
+
+  /// Current block.
+  protocol_archive_format::block m_block;
+
+  /// Packed symbols of the current block.
+  std::vector<std::uint64_t> m_words;
+
+  /// Number of occurrences of each symbol within the current block.
+  std::vector<std::uint64_t> m_counts;
+
+  /// Time of the previous entry.
+  double m_last_time;
+};
+
+/// Reader of a binary protocol archive, which is mapped into memory. Any time window is decoded
+/// without touching the blocks outside of it. The block index is validated once on opening, so
+/// that no block of a truncated or corrupted archive is read out of bounds.
+class protocol_archive
+{
+public:
+  /// Open the archive. Check is_open() for success.
+  /// \param _path path of the archive.
+  protocol_archive(const std::string& _path);
+
+  /// \return whether the archive has been opened and is valid.
+  bool is_open() const { return m_header != nullptr; }
+
+  /// \return the number of protocol entries.
+  std::uint64_t entry_count() const { return m_header->entry_count; }
+
+  /// \return the number of blocks.
+  std::uint64_t block_count() const { return m_header->block_count; }
+
+  /// Read the protocol entries of a time window.
+  /// \param _begin_time time of the first entry of the window.
+  /// \param _end_time time past the last entry of the window.
+  /// \param _protocol Vector to append the protocol entries to.
+  /// \return the number of appended protocol entries.
+  std::uint64_t read(const double _begin_time, const double _end_time, std::vector<order>& _protocol) const;
+
+  /// Count the occurrences of each symbol within a time window. Blocks completely inside of the
+  /// window are not decoded if the archive has summaries.
+  /// \param _begin_time time of the first entry of the window.
+  /// \param _end_time time past the last entry of the window.
+  /// \return the number of occurrences of each symbol.
+  std::vector<std::uint64_t> count(const double _begin_time, const double _end_time) const;
+
+private:
+  /// Check that the block index and the packed symbols of every block lie within the mapped file,
+  /// and that the blocks add up to the entries of the header.
+  /// \param _header header of the mapped file.
+  /// \return whether the archive is valid.
+  bool valid(const protocol_archive_format::header& _header) const;
+
+  /// \return the block record of the given block.
+  const protocol_archive_format::block& block(const std::uint64_t _block) const
+  {
+    return *reinterpret_cast<const protocol_archive_format::block*>(m_index + _block * m_record_size);
+  }
+
+  /// \return the number of occurrences of each symbol within the given block.
+  const std::uint64_t* block_counts(const std::uint64_t _block) const
+  {
+    return reinterpret_cast<const std::uint64_t*>(m_index + _block * m_record_size + sizeof(protocol_archive_format::block));
+  }
+
+  /// \return the index of the first block which may contain the given time.
+  std::uint64_t find(const double _time) const;
+
+  /// \return the index within the block of the first entry at or after the given time.
+  static std::uint64_t lower_bound(const protocol_archive_format::block& _block, const double _time);
+
+  /// \return the symbol of the given entry within the given block.
+  std::uint64_t symbol(const protocol_archive_format::block& _block, const std::uint64_t _entry) const;
+
+  /// Mapped archive file.
+  mapped_file m_file;
+
+  /// Header of the archive, nullptr if invalid.
+  const protocol_archive_format::header* m_header;
+
+  /// First 64 bit word after the header.
+  const std::uint64_t* m_words;
+
+  /// First byte of the block index.
+  const char* m_index;
+
+  /// Size of a block record including the symbol counts in bytes.
+  std::uint64_t m_record_size;
+};
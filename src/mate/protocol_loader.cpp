@@ -1,10 +1,81 @@
 #include "protocol_loader.h"
+#include "mapped_file.h"
+#include "trace.h"
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <sstream>
 
+namespace {
+
+/// Classification of every possible character for the in-place parser.
+struct character_table
+{
+  enum : std::uint8_t
+  {
+    space = 1,  ///< separates the tokens of a line
+    number = 2, ///< may be part of <time>
+    invalid = 0xFF
+  };
+
+  /// Class of each character.
+  std::uint8_t classes[256];
+
+  /// Order of each possible first character of a symbol, invalid for any other character.
+  std::uint8_t orders[256];
+
+  /// Length of the symbol of each order.
+  std::uint8_t lengths[256];
+
+  /// Symbol of each order.
+  const char* symbols[256];
+
+  character_table()
+  {
+    std::memset(classes, 0, sizeof(classes));
+    std::memset(orders, invalid, sizeof(orders));
+    std::memset(lengths, 0, sizeof(lengths));
+    std::memset(symbols, 0, sizeof(symbols));
+
+    classes[static_cast<std::uint8_t>(' ')] = space;
+    classes[static_cast<std::uint8_t>('\t')] = space;
+    classes[static_cast<std::uint8_t>('\r')] = space;
+    for (const char c : std::string("0123456789.+-eE"))
+    {
+      classes[static_cast<std::uint8_t>(c)] = number;
+    }
+
+    // symbols are distinguished by their first character
+    for (const auto& entry : map_string_to_order)
+    {
+      const std::uint8_t value = static_cast<std::uint8_t>(entry.second);
+      orders[static_cast<std::uint8_t>(entry.first[0])] = value;
+      lengths[value] = static_cast<std::uint8_t>(entry.first.size());
+      symbols[value] = entry.first.c_str();
+    }
+  }
+};
+
+const character_table table;
+
+/// Skip characters of the given class.
+inline const char* skip(const char* _current, const char* _end, const std::uint8_t _class)
+{
+  while (_current < _end && table.classes[static_cast<std::uint8_t>(*_current)] == _class) { _current++; }
+  return _current;
+}
+
+}; // namespace
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
 std::vector<order> protocol_loader::read(std::istream& _istream)
 {
+  MATE_TRACE_SCOPE("protocol_loader::read");
+
   std::vector<order> protocol;
 
   if (!_istream) return protocol;
@@ -21,3 +92,51 @@ std::vector<order> protocol_loader::read(std::istream& _istream)
 
   return protocol;
 }
+
+std::vector<order> protocol_loader::read(const std::string& _path)
+{
+  MATE_TRACE_SCOPE("protocol_loader::read");
+
+  std::vector<order> protocol;
+
+  mapped_file file(_path);
+  if (!file.is_open()) return protocol;
+
+  // a protocol entry takes at least four characters: "1 D\n"
+  protocol.reserve(file.size() / 4);
+  parse(file.data(), file.data() + file.size(), protocol);
+  protocol.shrink_to_fit();
+  MATE_TRACE_COUNTER("protocol_loader entries", protocol.size());
+
+  return protocol;
+}
+
+const char* protocol_loader::parse(const char* _begin, const char* _end, std::vector<order>& _protocol)
+{
+  const char* line = _begin;
+  while (line < _end)
+  {
+    const char* line_end = static_cast<const char*>(std::memchr(line, '\n', _end - line));
+    if (line_end == nullptr) { line_end = _end; }
+
+    // <time>, only validated
+    const char* time = skip(line, line_end, character_table::space);
+    const char* current = skip(time, line_end, character_table::number);
+    if (current == time) { break; } // error
+    current = skip(current, line_end, character_table::space);
+
+    // <order>, decoded from its first character and compared in full
+    const std::uint8_t first = (current < line_end) ? static_cast<std::uint8_t>(*current) : 0;
+    const std::uint8_t value = table.orders[first];
+    if (value == character_table::invalid) { break; } // error
+    const std::uint8_t length = table.lengths[value];
+    if (line_end - current < length || std::memcmp(current, table.symbols[value], length) != 0) { break; } // error
+    current += length;
+    if (current < line_end && table.classes[static_cast<std::uint8_t>(*current)] != character_table::space) { break; } // error
+
+    _protocol.push_back(static_cast<order>(value));
+    line = (line_end < _end) ? line_end + 1 : _end;
+  }
+
+  return line;
+}
@@ -3,6 +3,7 @@
 #include "enum_order.h"
 
 #include <iosfwd>
+#include <string>
 #include <vector>
 #include <utility>
 
@@ -16,4 +17,19 @@ public:
   /// <time> = <index> + 1
   /// \return Vector of protocol entries.
   std::vector<order> read(std::istream& _istream);
+
+  /// Read a protocol file by mapping it into memory and scanning it in place. Equivalent to
+  /// read(std::istream&) on a well-formed file, but without copying or converting any line.
+  /// \param _path path of the protocol file.
+  /// \return Vector of protocol entries.
+  std::vector<order> read(const std::string& _path);
+
+  /// Parse protocol entries from memory and append them to the result vector. The <time> of each
+  /// entry is validated but skipped, the <order> is decoded by a table lookup of its first
+  /// character. Parsing stops at the first malformed line, like read(std::istream&).
+  /// \param _begin first character.
+  /// \param _end character past the last character.
+  /// \param _protocol Vector of protocol entries to append to.
+  /// \return the character past the last parsed line, _end if every line has been parsed.
+  static const char* parse(const char* _begin, const char* _end, std::vector<order>& _protocol);
 };
@@ -0,0 +1,68 @@
+#include "protocol_stream.h"
+#include "protocol_loader.h"
+
+#include <cstring>
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+protocol_stream::protocol_stream()
+  : m_failed(false)
+{
+  /* empty */
+}
+
+std::uint64_t protocol_stream::feed(const char* _data, const std::uint64_t _size, std::vector<order>& _entries)
+{
+  if (m_failed) { return 0; }
+
+  const char* current = _data;
+  const char* end = _data + _size;
+  std::uint64_t count = 0;
+
+  // complete the pending line first
+  if (!m_pending.empty())
+  {
+    const char* line_end = static_cast<const char*>(std::memchr(current, '\n', end - current));
+    if (line_end == nullptr)
+    {
+      m_pending.append(current, end);
+      return 0;
+    }
+    m_pending.append(current, line_end + 1);
+    count += parse(m_pending.data(), m_pending.data() + m_pending.size(), _entries);
+    m_pending.clear();
+    current = line_end + 1;
+  }
+
+  // parse every complete line in place, keep the incomplete rest
+  const char* last = end;
+  while (last > current && last[-1] != '\n') { last--; }
+  count += parse(current, last, _entries);
+  if (!m_failed) { m_pending.assign(last, end); }
+
+  return count;
+}
+
+std::uint64_t protocol_stream::finish(std::vector<order>& _entries)
+{
+  if (m_failed || m_pending.empty()) { return 0; }
+
+  const std::uint64_t count = parse(m_pending.data(), m_pending.data() + m_pending.size(), _entries);
+  m_pending.clear();
+  return count;
+}
+
+// -------------------------------------------------------------------------------------------------
+// private
+// -------------------------------------------------------------------------------------------------
+
+std::uint64_t protocol_stream::parse(const char* _begin, const char* _end, std::vector<order>& _entries)
+{
+  if (m_failed) { return 0; }
+
+  const std::uint64_t size = _entries.size();
+  if (protocol_loader::parse(_begin, _end, _entries) != _end) { m_failed = true; }
+  return _entries.size() - size;
+}
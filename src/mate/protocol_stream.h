@@ -0,0 +1,45 @@
+#pragma once
+
+#include "enum_order.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Push-based parser of a live status protocol in the format of protocol_loader. The protocol is
+/// fed in chunks of any size as it arrives, e.g. from a socket or a growing file. Complete lines
+/// are parsed in place, only an incomplete line at the end of a chunk is kept until the next one,
+/// so the memory use does not grow with the length of the protocol.
+class protocol_stream
+{
+public:
+  protocol_stream();
+
+  /// Parse the complete lines of the next chunk of the protocol.
+  /// \param _data first character of the chunk.
+  /// \param _size number of characters in the chunk.
+  /// \param _entries Vector to append the parsed protocol entries to. Clear it between chunks to
+  ///   keep the memory constant.
+  /// \return the number of appended protocol entries.
+  std::uint64_t feed(const char* _data, const std::uint64_t _size, std::vector<order>& _entries);
+
+  /// Parse the last line of the protocol, if it is not terminated by a line break.
+  /// \param _entries Vector to append the parsed protocol entry to.
+  /// \return the number of appended protocol entries.
+  std::uint64_t finish(std::vector<order>& _entries);
+
+  /// \return whether a malformed line has been encountered. Like protocol_loader::read(), the
+  ///   stream ignores everything after the first malformed line.
+  bool failed() const { return m_failed; }
+
+private:
+  /// Parse complete lines and remember whether they were well-formed.
+  /// \return the number of appended protocol entries.
+  std::uint64_t parse(const char* _begin, const char* _end, std::vector<order>& _entries);
+
+  /// Incomplete line at the end of the last chunk.
+  std::string m_pending;
+
+  /// Whether a malformed line has been encountered.
+  bool m_failed;
+};
@@ -1,10 +1,11 @@
 #include "random.h"
 
+#include <random>
+
 namespace math {
 
-std::random_device random_device;
-std::mt19937_64 engine(random_device());
-std::uniform_real_distribution<> uniform_real_distribution(0,1);
-std::normal_distribution<> normal_distribution(0,1);
+std::atomic<std::uint64_t> seed_value(std::random_device{}());
+std::atomic<std::uint64_t> seed_generation(0);
+std::atomic<std::uint64_t> stream_count(0);
 
 }; // namespace math
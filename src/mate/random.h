@@ -1,29 +1,55 @@
 #pragma once
 
+#include "philox.h"
+
+#include <Eigen/Dense>
+
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
-#include <random>
 #include <cmath>
 
 namespace math {
 
-extern std::random_device random_device;
-extern std::mt19937_64 engine;
-extern std::uniform_real_distribution<> uniform_real_distribution;
-extern std::normal_distribution<> normal_distribution;
+/// Seed shared by the generators of all threads.
+extern std::atomic<std::uint64_t> seed_value;
+/// Incremented on every call to seed() to invalidate the generators of all threads.
+extern std::atomic<std::uint64_t> seed_generation;
+/// Number of generators created since the last call to seed(), the stream index of the next one.
+extern std::atomic<std::uint64_t> stream_count;
 
 /// Define a seed for general pseudo random number generation.
+/// The generator of every thread restarts on its next use with the next unused stream of the seed,
+/// i.e. streams are handed out in the order the threads draw their first number after this call.
+/// A single threaded program is therefore reproducible, while the streams of concurrently drawing
+/// threads depend on scheduling. Use random_stream for results independent of the thread order.
 inline void seed(const std::uint64_t _seed)
 {
-  std::uint32_t seed = static_cast<std::uint32_t>(_seed);
-  engine.seed(seed);
-  std::srand(seed);
+  seed_value = _seed;
+  stream_count = 0;
+  seed_generation++;
+  std::srand(static_cast<std::uint32_t>(_seed));
+}
+
+/// \return the pseudo random number generator of the calling thread.
+inline philox& engine()
+{
+  static thread_local philox generator;
+  static thread_local std::uint64_t generation = std::numeric_limits<std::uint64_t>::max();
+
+  const std::uint64_t current = seed_generation.load(std::memory_order_acquire);
+  if (generation != current)
+  {
+    generator = philox(seed_value.load(std::memory_order_relaxed), stream_count++);
+    generation = current;
+  }
+  return generator;
 }
 
 /// Generate a uniform random number between zero and one.
 inline double random()
 {
-  return uniform_real_distribution(engine);
+  return philox::to_uniform(engine()());
 }
 
 /// Generate a uniform random number within the specified range.
@@ -37,7 +63,9 @@ inline double random(const double _min, const double _max)
 /// Generate a normally distributed random number with (_mean = 0) and (_variance = 1).
 inline double random_normal()
 {
-  return normal_distribution(engine);
+  double result;
+  engine().fill_normal(&result, 1);
+  return result;
 }
 
 /// Generate a normally distributed random number with the specified mean and variance.
@@ -48,19 +76,133 @@ inline double random_normal(const double _mean, const double _variance)
   return _variance * random_normal() + _mean;
 }
 
+/// Generate an unbiased, uniform random integer in [0,_range) from the given generator by
+/// Lemire's multiply-shift method, which rejects only a tiny fraction of the raw numbers.
+/// \param _generator generator to draw the raw numbers from.
+/// \param _range number of possible values.
+inline std::uint32_t random_bounded(philox& _generator, const std::uint32_t _range)
+{
+  std::uint64_t product = (_generator() >> 32) * _range;
+  std::uint32_t low = static_cast<std::uint32_t>(product);
+  if (low < _range)
+  {
+    const std::uint32_t threshold = (0u - _range) % _range;
+    while (low < threshold)
+    {
+      product = (_generator() >> 32) * _range;
+      low = static_cast<std::uint32_t>(product);
+    }
+  }
+  return static_cast<std::uint32_t>(product >> 32);
+}
+
 /// Generate a uniform random integer with the specified maximal value.
-/// \param _max maximum of the integer value.
+/// \param _max maximum of the integer value (exclusive).
 inline int random_int(const int _max)
 {
-  return static_cast<int>(std::floor(_max * random()));
+  if (_max <= 0) { return 0; }
+  return static_cast<int>(random_bounded(engine(), static_cast<std::uint32_t>(_max)));
 }
 
 /// Generate a uniform random integer within the specified range.
 /// \param _min minimum of the integer value range.
-/// \param _max maximum of the integer value range.
+/// \param _max maximum of the integer value range (exclusive).
 inline int random_int(const int _min, const int _max)
 {
-  return _min + static_cast<int>(std::floor((_max - _min) * random()));
+  if (_max <= _min) { return _min; }
+  const std::uint32_t range = static_cast<std::uint32_t>(static_cast<std::int64_t>(_max) - _min);
+  return static_cast<int>(_min + static_cast<std::int64_t>(random_bounded(engine(), range)));
+}
+
+/// Fill the vector with uniform random numbers between zero and one.
+/// \param _result vector to fill.
+inline void fill_uniform(Eigen::Ref<Eigen::VectorXd> _result)
+{
+  engine().fill_uniform(_result.data(), _result.size());
+}
+
+/// Fill the vector with normally distributed random numbers with (_mean = 0) and
+/// (_variance = 1).
+/// \param _result vector to fill.
+inline void fill_normal(Eigen::Ref<Eigen::VectorXd> _result)
+{
+  engine().fill_normal(_result.data(), _result.size());
 }
 
+/// An independent stream of pseudo random numbers. Streams created from the same seed and stream
+/// index always generate the same sequence of numbers, regardless of the thread they are used on.
+/// A stream holds no shared state and is safe to use concurrently with other streams. Creating a
+/// stream and skipping ahead within it are O(1) operations.
+class random_stream
+{
+public:
+  /// Create the stream with the given index for the given seed.
+  /// \param _seed seed shared by all streams of a computation.
+  /// \param _stream index of this stream.
+  random_stream(const std::uint64_t _seed, const std::uint64_t _stream)
+    : m_engine(_seed, _stream)
+  {
+    /* empty */
+  }
+
+  /// Generate a uniform random number between zero and one.
+  double random()
+  {
+    return philox::to_uniform(m_engine());
+  }
+
+  /// Generate a normally distributed random number with (_mean = 0) and (_variance = 1).
+  double random_normal()
+  {
+    double result;
+    m_engine.fill_normal(&result, 1);
+    return result;
+  }
+
+  /// Generate a uniform random integer with the specified maximal value.
+  /// \param _max maximum of the integer value (exclusive).
+  std::uint32_t random_int(const std::uint32_t _max)
+  {
+    return (_max == 0) ? 0 : random_bounded(m_engine, _max);
+  }
+
+  /// Skip the given number of random numbers, as if random() was called that many times.
+  /// \param _count number of random numbers to skip.
+  void discard(const std::uint64_t _count)
+  {
+    m_engine.discard(_count);
+  }
+
+  /// Create the stream with the given index for the same seed.
+  /// \param _stream index of the new stream.
+  random_stream split(const std::uint64_t _stream) const
+  {
+    return random_stream(m_engine.split(_stream));
+  }
+
+  /// Fill the vector with uniform random numbers between zero and one.
+  /// \param _result vector to fill.
+  void fill_uniform(Eigen::Ref<Eigen::VectorXd> _result)
+  {
+    m_engine.fill_uniform(_result.data(), _result.size());
+  }
+
+  /// Fill the vector with normally distributed random numbers with (_mean = 0) and
+  /// (_variance = 1).
+  /// \param _result vector to fill.
+  void fill_normal(Eigen::Ref<Eigen::VectorXd> _result)
+  {
+    m_engine.fill_normal(_result.data(), _result.size());
+  }
+
+private:
+  explicit random_stream(const philox& _engine)
+    : m_engine(_engine)
+  {
+    /* empty */
+  }
+
+  philox m_engine;
+};
+
 }; // namespace math
@@ -0,0 +1,322 @@
+#pragma once
+
+#include "discrete_distribution.h"
+#include "log_space.h"
+#include "markov_chain.h"
+#include "trace.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+/// A hidden semi-markov chain with explicit durations. Each visit of a state is a segment, whose
+/// length is drawn from the duration distribution of the state, and every observation of the
+/// segment is emitted by that state. The initial state vector, the transitions between segments
+/// and the emissions are those of a markov chain, whose self-transitions therefore start a new
+/// segment of the same state. A non-exponential sojourn time is modeled without tracking the age
+/// of the state in a proxel or a chain of phases.
+/// The forward and Viterbi algorithms run in log-space in O(T * N * D + T * N^2) for T
+/// observations, N states and a maximum duration of D steps. The log-emissions of a segment are
+/// the difference of two cumulative sums, which are computed once per observation.
+/// The last segment may continue beyond the last observation, it is weighted by the probability
+/// of a duration at least as long as observed.
+/// \tparam chain Type of the markov chain, e.g. markov_chain<>.
+template<typename chain>
+class semi_markov_chain
+{
+public:
+  /// Define the semi-markov chain by a markov chain and the duration distribution of each state.
+  /// \param _markov_chain markov chain of the initial state vector, the transitions between
+  ///   segments and the emissions, which has to outlive the semi-markov chain.
+  /// \param _durations probability of a segment of each state (one distribution each) to last
+  ///   1, 2, ... D steps, where D is the number of possible observations of the longest
+  ///   distribution.
+  semi_markov_chain(const chain& _markov_chain, const std::vector<discrete_distribution>& _durations);
+
+  /// Discretize the sojourn time of a hazard rate function into a duration distribution, as the
+  /// proxel solver does: a segment of age a ends within the next step with probability
+  /// min(_delta_t * hazard(a), 1). The probability of lasting longer than the maximum duration is
+  /// added to the maximum duration.
+  /// \param _hazard_rate hazard rate function of the age.
+  /// \param _max_duration maximum duration D in steps.
+  /// \param _delta_t size of a single, discrete time step.
+  /// \return probability of lasting 1, 2, ... D steps.
+  static discrete_distribution duration(
+    const std::function<double(double)>& _hazard_rate,
+    const std::uint64_t _max_duration,
+    const double _delta_t
+  );
+
+  /// Compute the log-likelihood of the observation sequence by the forward algorithm.
+  /// \param _sequence Sequence of observations.
+  /// \return natural logarithm of the probability of the observation sequence.
+  double log_likelihood(const std::vector<std::uint64_t>& _sequence) const;
+
+  /// Compute the most likely sequence of states to emit the observation sequence by the Viterbi
+  /// algorithm over segments.
+  /// \param _sequence Sequence of observations.
+  /// \return the most likely sequence of states. One for each observation.
+  std::vector<std::uint64_t> viterbi(const std::vector<std::uint64_t>& _sequence) const;
+
+  /// \return the maximum duration D of a segment in steps.
+  std::uint64_t max_duration() const { return m_log_durations.rows(); }
+
+  /// \return the embedded markov chain of the transitions between segments and the emissions.
+  const chain& embedded_chain() const { return m_markov_chain; }
+
+  /// \return the duration distribution of each state.
+  const std::vector<discrete_distribution>& durations() const { return m_durations; }
+
+private:
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> row_matrix;
+
+  /// Cumulative log-emissions of each state (columns) over the first t observations (rows).
+  /// Impossible emissions are counted separately, as their log-probability of negative infinity
+  /// would turn the difference of two sums into NaN.
+  struct emission_sums
+  {
+    /// Sum of the finite log-emissions.
+    row_matrix sums;
+
+    /// Number of impossible emissions.
+    Eigen::Matrix<std::uint64_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> impossible;
+
+    /// \return the log-probability of state _j to emit the observations t - d + 1 ... t.
+    double segment(const std::uint64_t _t, const std::uint64_t _d, const std::uint64_t _j) const
+    {
+      if (impossible(_t, _j) != impossible(_t - _d, _j)) { return -std::numeric_limits<double>::infinity(); }
+      return sums(_t, _j) - sums(_t - _d, _j);
+    }
+  };
+
+  /// Sum up the log-emissions of each state over the observation sequence.
+  /// \param _sequence Sequence of observations.
+  /// \return T + 1 cumulative sums, starting with zero.
+  emission_sums cumulative_log_emissions(const std::vector<std::uint64_t>& _sequence) const;
+
+  /// Markov chain of the transitions between segments and the emissions.
+  const chain& m_markov_chain;
+
+  /// Duration distribution of each state.
+  std::vector<discrete_distribution> m_durations;
+
+  /// Log-probability of a segment of each state (columns) to last d + 1 steps (rows).
+  Eigen::MatrixXd m_log_durations;
+
+  /// Log-probability of a segment of each state (columns) to last at least d + 1 steps (rows).
+  Eigen::MatrixXd m_log_survivals;
+
+  /// Transition probabilities between segments.
+  Eigen::MatrixXd m_transition_matrix;
+};
+
+// -------------------------------------------------------------------------------------------------
+// implementation
+// -------------------------------------------------------------------------------------------------
+
+template<typename chain>
+semi_markov_chain<chain>::semi_markov_chain(
+  const chain& _markov_chain,
+  const std::vector<discrete_distribution>& _durations
+) : m_markov_chain(_markov_chain)
+  , m_durations(_durations)
+  , m_transition_matrix(_markov_chain.transition_matrix().template cast<double>())
+{
+  std::uint64_t max_duration = 1;
+  for (const discrete_distribution& d : m_durations)
+  {
+    max_duration = std::max<std::uint64_t>(max_duration, d.probabilities().size());
+  }
+
+  const std::uint64_t state_count = m_durations.size();
+  Eigen::MatrixXd probabilities = Eigen::MatrixXd::Zero(max_duration, state_count);
+  for (std::uint64_t j = 0; j < state_count; j++)
+  {
+    const Eigen::VectorXd& p = m_durations[j].probabilities();
+    probabilities.col(j).head(p.size()) = p;
+  }
+
+  // survival of d + 1 steps is the sum of the probabilities of d + 1 ... D steps
+  Eigen::MatrixXd survivals(max_duration, state_count);
+  survivals.row(max_duration - 1) = probabilities.row(max_duration - 1);
+  for (std::uint64_t d = max_duration - 1; d > 0; d--)
+  {
+    survivals.row(d - 1) = survivals.row(d) + probabilities.row(d - 1);
+  }
+
+  m_log_durations = probabilities.array().log();
+  m_log_survivals = survivals.array().log();
+}
+
+template<typename chain>
+discrete_distribution semi_markov_chain<chain>::duration(
+  const std::function<double(double)>& _hazard_rate,
+  const std::uint64_t _max_duration,
+  const double _delta_t)
+{
+  const std::uint64_t max_duration = std::max<std::uint64_t>(_max_duration, 1);
+  Eigen::VectorXd probabilities(max_duration);
+
+  double survival = 1;
+  for (std::uint64_t d = 0; d < max_duration; d++)
+  {
+    const double z = std::min(_delta_t * _hazard_rate(d * _delta_t), 1.0);
+    probabilities[d] = survival * z;
+    survival -= probabilities[d];
+  }
+  probabilities[max_duration - 1] += survival;
+
+  return discrete_distribution(probabilities);
+}
+
+template<typename chain>
+double semi_markov_chain<chain>::log_likelihood(const std::vector<std::uint64_t>& _sequence) const
+{
+  MATE_TRACE_SCOPE("semi_markov_chain::log_likelihood");
+
+  const std::uint64_t length = _sequence.size();
+  const std::uint64_t state_count = m_durations.size();
+  const std::uint64_t max_duration = m_log_durations.rows();
+
+  if (length == 0) { return 0; }
+
+  const emission_sums emissions = cumulative_log_emissions(_sequence);
+
+  // log-probability of a segment of each state (columns) to start right after t steps (rows)
+  row_matrix starts(length, state_count);
+  starts.row(0) = m_markov_chain.initial_state().array().log();
+
+  Eigen::RowVectorXd alpha(state_count);
+  Eigen::RowVectorXd scratch(state_count);
+  Eigen::RowVectorXd next(state_count);
+  Eigen::RowVectorXd candidates(max_duration);
+  double result = -std::numeric_limits<double>::infinity();
+
+  for (std::uint64_t t = 1; t <= length; t++)
+  {
+    // a segment of each state ending with step t, with the last segment continuing beyond it
+    const bool last = (t == length);
+    const Eigen::MatrixXd& log_durations = last ? m_log_survivals : m_log_durations;
+    const std::uint64_t longest = std::min(max_duration, t);
+
+    for (std::uint64_t j = 0; j < state_count; j++)
+    {
+      for (std::uint64_t d = 1; d <= longest; d++)
+      {
+        candidates[d - 1] = log_durations(d - 1, j) + emissions.segment(t, d, j) + starts(t - d, j);
+      }
+      alpha[j] = math::logsumexp(candidates.head(longest));
+    }
+
+    if (last) { result = math::logsumexp(alpha); break; }
+
+    // the next segment starts after step t
+    math::log_product(alpha, m_transition_matrix, scratch, next);
+    starts.row(t) = next;
+  }
+
+  return result;
+}
+
+template<typename chain>
+std::vector<std::uint64_t> semi_markov_chain<chain>::viterbi(const std::vector<std::uint64_t>& _sequence) const
+{
+  MATE_TRACE_SCOPE("semi_markov_chain::viterbi");
+
+  const std::uint64_t length = _sequence.size();
+  const std::uint64_t state_count = m_durations.size();
+  const std::uint64_t max_duration = m_log_durations.rows();
+  std::vector<std::uint64_t> result(length);
+
+  if (length == 0) { return result; }
+
+  const emission_sums emissions = cumulative_log_emissions(_sequence);
+
+  // transposed into row-major storage, so that the transitions into a state are contiguous
+  const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> log_transition_matrix = m_transition_matrix.transpose().array().log();
+
+  // most likely log-probability of a segment of each state (columns) to start right after t steps
+  // (rows), with the state of the preceding segment
+  row_matrix starts(length, state_count);
+  Eigen::Matrix<std::uint64_t, Eigen::Dynamic, Eigen::Dynamic> predecessor(length, state_count);
+  starts.row(0) = m_markov_chain.initial_state().array().log();
+
+  // most likely duration of a segment of each state (columns) ending with step t (rows)
+  Eigen::Matrix<std::uint64_t, Eigen::Dynamic, Eigen::Dynamic> durations(length + 1, state_count);
+
+  Eigen::RowVectorXd delta(state_count);
+  Eigen::RowVectorXd candidates(max_duration);
+
+  for (std::uint64_t t = 1; t <= length; t++)
+  {
+    const bool last = (t == length);
+    const Eigen::MatrixXd& log_durations = last ? m_log_survivals : m_log_durations;
+    const std::uint64_t longest = std::min(max_duration, t);
+
+    for (std::uint64_t j = 0; j < state_count; j++)
+    {
+      for (std::uint64_t d = 1; d <= longest; d++)
+      {
+        candidates[d - 1] = log_durations(d - 1, j) + emissions.segment(t, d, j) + starts(t - d, j);
+      }
+      Eigen::MatrixXd::Index d;
+      delta[j] = candidates.head(longest).maxCoeff(&d);
+      durations(t, j) = d + 1;
+    }
+
+    if (last) { break; }
+
+    for (std::uint64_t j = 0; j < state_count; j++)
+    {
+      Eigen::MatrixXd::Index i;
+      starts(t, j) = (delta + log_transition_matrix.row(j)).maxCoeff(&i);
+      predecessor(t, j) = i;
+    }
+  }
+
+  // backtrack segment by segment from the most likely final state
+  Eigen::MatrixXd::Index state;
+  delta.maxCoeff(&state);
+  std::uint64_t t = length;
+  while (t > 0)
+  {
+    const std::uint64_t d = durations(t, state);
+    std::fill(result.begin() + (t - d), result.begin() + t, static_cast<std::uint64_t>(state));
+    t -= d;
+    if (t > 0) { state = predecessor(t, state); }
+  }
+
+  return result;
+}
+
+template<typename chain>
+typename semi_markov_chain<chain>::emission_sums
+semi_markov_chain<chain>::cumulative_log_emissions(const std::vector<std::uint64_t>& _sequence) const
+{
+  const std::uint64_t state_count = m_durations.size();
+
+  emission_sums result;
+  result.sums.resize(_sequence.size() + 1, state_count);
+  result.impossible.resize(_sequence.size() + 1, state_count);
+  result.sums.row(0).setZero();
+  result.impossible.row(0).setZero();
+
+  Eigen::RowVectorXd log_emissions(state_count);
+  for (std::uint64_t t = 0; t < _sequence.size(); t++)
+  {
+    log_emissions.setZero();
+    m_markov_chain.emissions().log_emit(_sequence[t], log_emissions);
+    for (std::uint64_t j = 0; j < state_count; j++)
+    {
+      const bool possible = std::isfinite(log_emissions[j]);
+      result.sums(t + 1, j) = result.sums(t, j) + (possible ? log_emissions[j] : 0);
+      result.impossible(t + 1, j) = result.impossible(t, j) + (possible ? 0 : 1);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "markov_chain.h"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+
+/// Allocation-free stepping engine of a markov chain. The state vectors are allocated once on
+/// construction and swapped in every step, products are evaluated with noalias() directly into
+/// them, so stepping never touches the heap. The state vector can be recorded after every step or
+/// every k-th step into a buffer of the caller, which yields transient curves of every state, e.g.
+/// the probability of a machine to be in each state over time.
+/// \tparam chain Type of the markov chain, e.g. markov_chain<>.
+template<typename chain>
+class stepper
+{
+public:
+  /// Allocate the state vectors and start with the initial state vector of the markov chain.
+  /// \param _markov_chain markov chain to step, which has to outlive the stepper.
+  stepper(const chain& _markov_chain);
+
+  /// Start over with the initial state vector of the markov chain.
+  void reset();
+
+  /// Start over with the given state vector.
+  /// \param _state_vector state vector of the size of the markov chain.
+  void reset(const Eigen::RowVectorXd& _state_vector);
+
+  /// Step the state vector the specified number of times or until the rate of change threshold
+  /// requirements are met. Record the state vector after every _every-th step into the
+  /// trajectory, and the state vector before the first step if nothing has been stepped since the
+  /// last reset. Recording stops when the trajectory is full.
+  /// \param _steps Number of steps to evaluate.
+  /// \param _epsilon Threshold for the rate of change of the state vector between each step,
+  ///   measured in euclidean distance. Set epsilon to a negative value to deactivate its break
+  ///   condition.
+  /// \param _trajectory (optional) buffer of _capacity rows of state vectors in row-major order,
+  ///   i.e. the probability of state j at the i-th recording is _trajectory[i * states + j].
+  /// \param _capacity number of rows of the trajectory.
+  /// \param _every record every _every-th step.
+  /// \return the number of evaluated steps.
+  std::uint64_t run(
+    const std::uint64_t _steps,
+    const double _epsilon = -1,
+    double* _trajectory = nullptr,
+    const std::uint64_t _capacity = 0,
+    const std::uint64_t _every = 1
+  );
+
+  /// \return the current state vector.
+  const Eigen::RowVectorXd& state() const { return m_current; }
+
+  /// \return the number of steps since the last reset.
+  std::uint64_t step_count() const { return m_step_count; }
+
+  /// \return the number of state vectors recorded by the last run.
+  std::uint64_t recorded() const { return m_recorded; }
+
+private:
+  /// Copy the current state vector into the next row of the trajectory, if there is one left.
+  void record(double* _trajectory, const std::uint64_t _capacity);
+
+  /// Stepped markov chain.
+  const chain& m_markov_chain;
+
+  /// Current state vector.
+  Eigen::RowVectorXd m_current;
+
+  /// Storage of the next state vector.
+  Eigen::RowVectorXd m_next;
+
+  /// Number of steps since the last reset.
+  std::uint64_t m_step_count;
+
+  /// Number of state vectors recorded by the last run.
+  std::uint64_t m_recorded;
+};
+
+// -------------------------------------------------------------------------------------------------
+// implementation
+// -------------------------------------------------------------------------------------------------
+
+template<typename chain>
+stepper<chain>::stepper(const chain& _markov_chain)
+  : m_markov_chain(_markov_chain)
+  , m_current(_markov_chain.initial_state())
+  , m_next(_markov_chain.initial_state().size())
+  , m_step_count(0)
+  , m_recorded(0)
+{
+  /* empty */
+}
+
+template<typename chain>
+void stepper<chain>::reset()
+{
+  reset(m_markov_chain.initial_state());
+}
+
+template<typename chain>
+void stepper<chain>::reset(const Eigen::RowVectorXd& _state_vector)
+{
+  m_current = _state_vector; // same size, no reallocation
+  m_step_count = 0;
+  m_recorded = 0;
+}
+
+template<typename chain>
+std::uint64_t stepper<chain>::run(
+  const std::uint64_t _steps,
+  const double _epsilon,
+  double* _trajectory,
+  const std::uint64_t _capacity,
+  const std::uint64_t _every)
+{
+  MATE_TRACE_SCOPE("stepper::run");
+
+  const std::uint64_t every = (_every == 0) ? 1 : _every;
+  m_recorded = 0;
+
+  if (m_step_count == 0) { record(_trajectory, _capacity); }
+
+  std::uint64_t i;
+  for (i = 0; i < _steps; i++)
+  {
+    markov_chain_detail::step(m_current, m_markov_chain.transition_matrix(), m_next);
+    const double distance = (m_next - m_current).norm();
+    m_current.swap(m_next);
+    m_step_count++;
+
+    if (m_step_count % every == 0) { record(_trajectory, _capacity); }
+
+    if (distance <= _epsilon) { i++; break; }
+  }
+
+  return i;
+}
+
+template<typename chain>
+void stepper<chain>::record(double* _trajectory, const std::uint64_t _capacity)
+{
+  if (_trajectory == nullptr || m_recorded >= _capacity) { return; }
+
+  const std::uint64_t state_count = m_current.size();
+  Eigen::Map<Eigen::RowVectorXd>(_trajectory + m_recorded * state_count, state_count) = m_current;
+  m_recorded++;
+}
@@ -0,0 +1,155 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+
+/// Pool and index of the calling worker thread.
+thread_local const thread_pool* current_pool = nullptr;
+thread_local std::uint64_t current_index = 0;
+
+}; // namespace
+
+// -------------------------------------------------------------------------------------------------
+// public
+// -------------------------------------------------------------------------------------------------
+
+thread_pool::thread_pool(const std::uint64_t _thread_count)
+  : m_next_queue(0)
+  , m_queued(0)
+  , m_pending(0)
+  , m_stop(false)
+{
+  std::uint64_t count = _thread_count;
+  if (count == 0)
+  {
+    // hardware_concurrency() is allowed to return zero if the value is not computable
+    count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  m_queues.reserve(count);
+  for (std::uint64_t i = 0; i < count; i++)
+  {
+    m_queues.emplace_back(new queue());
+  }
+
+  m_threads.reserve(count);
+  for (std::uint64_t i = 0; i < count; i++)
+  {
+    m_threads.push_back(std::thread(&thread_pool::work, this, i));
+  }
+}
+
+thread_pool::~thread_pool()
+{
+  wait();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_task_available.notify_all();
+
+  for (auto& thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+std::uint64_t thread_pool::worker_index() const
+{
+  return (current_pool == this) ? current_index : thread_count();
+}
+
+void thread_pool::submit(std::function<void()> _task)
+{
+  const bool external = (current_pool != this);
+  const std::uint64_t index = external ? m_next_queue++ % m_queues.size() : current_index;
+
+  m_pending++;
+  {
+    // counted under the lock of the queue, so a worker can never take the task before it is
+    // counted and m_queued never falls below the number of queued tasks
+    std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+    m_queued++;
+    (external ? m_queues[index]->external : m_queues[index]->tasks).push_back(std::move(_task));
+  }
+
+  // synchronize with a worker about to sleep, so that the notification is not lost
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+  m_task_available.notify_one();
+}
+
+void thread_pool::wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_task_finished.wait(lock, [this] { return m_pending == 0; });
+}
+
+// -------------------------------------------------------------------------------------------------
+// private
+// -------------------------------------------------------------------------------------------------
+
+void thread_pool::work(const std::uint64_t _index)
+{
+  current_pool = this;
+  current_index = _index;
+
+  for (;;)
+  {
+    std::function<void()> task;
+
+    if (!take(_index, task))
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_task_available.wait(lock, [this] { return m_stop || m_queued > 0; });
+      if (m_stop && m_queued == 0) { return; } // stop requested and nothing left to do
+      continue;
+    }
+
+    task();
+
+    if (--m_pending == 0)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_task_finished.notify_all();
+    }
+  }
+}
+
+bool thread_pool::take(const std::uint64_t _index, std::function<void()>& _task)
+{
+  const std::uint64_t count = m_queues.size();
+  for (std::uint64_t i = 0; i < count; i++)
+  {
+    queue& current = *m_queues[(_index + i) % count];
+    std::lock_guard<std::mutex> lock(current.mutex);
+
+    // newest own task (still in cache), then the oldest task submitted from outside, which keeps
+    // the order of submission, e.g. longest first of batch_scorer
+    if (i == 0 && !current.tasks.empty())
+    {
+      _task = std::move(current.tasks.back());
+      current.tasks.pop_back();
+    }
+    else if (!current.external.empty())
+    {
+      _task = std::move(current.external.front());
+      current.external.pop_front();
+    }
+    else if (!current.tasks.empty())
+    {
+      _task = std::move(current.tasks.front());
+      current.tasks.pop_front();
+    }
+    else
+    {
+      continue;
+    }
+    m_queued--;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A fixed set of worker threads with a queue of tasks each. Tasks submitted from outside of the
+/// pool are distributed round-robin and run in the order of submission, tasks submitted by a
+/// worker go to its own queue and run newest first. A worker takes the newest task it submitted
+/// itself, then the oldest task submitted from outside to its queue and, once both are empty,
+/// steals the oldest task of another worker, which balances tasks of very uneven cost. The
+/// controlling thread may wait for all tasks to finish.
+class thread_pool
+{
+public:
+  /// Start the given number of worker threads.
+  /// \param _thread_count number of worker threads. Zero selects the number of hardware threads.
+  thread_pool(const std::uint64_t _thread_count = 0);
+
+  /// Wait for all submitted tasks and join the worker threads.
+  ~thread_pool();
+
+  /// \return the number of worker threads.
+  std::uint64_t thread_count() const { return m_threads.size(); }
+
+  /// \return the index of the calling worker thread in [0,thread_count()), or thread_count() if
+  ///   the calling thread is not a worker of this pool. Useful to index scratch buffers.
+  std::uint64_t worker_index() const;
+
+  /// Queue a task for execution on any worker thread.
+  /// \param _task task to execute.
+  void submit(std::function<void()> _task);
+
+  /// Block until every submitted task has finished.
+  void wait();
+
+private:
+  thread_pool(const thread_pool&);
+  thread_pool& operator=(const thread_pool&);
+
+  /// Tasks of a single worker thread.
+  struct queue
+  {
+    std::mutex mutex;
+    /// Tasks submitted from outside of the pool, taken oldest first.
+    std::deque<std::function<void()>> external;
+    /// Tasks submitted by the worker itself, taken newest first by the worker.
+    std::deque<std::function<void()>> tasks;
+  };
+
+  /// Main loop of a single worker thread.
+  /// \param _index index of the worker thread.
+  void work(const std::uint64_t _index);
+
+  /// Take the newest task the worker submitted itself, the oldest task submitted from outside to
+  /// its queue or steal the oldest task of another queue.
+  /// \param _index index of the worker thread.
+  /// \param _task destination of the task.
+  /// \return whether a task has been found.
+  bool take(const std::uint64_t _index, std::function<void()>& _task);
+
+  /// Worker threads.
+  std::vector<std::thread> m_threads;
+
+  /// Queue of each worker thread.
+  std::vector<std::unique_ptr<queue>> m_queues;
+
+  /// Queue of the next task submitted from outside of the pool.
+  std::atomic<std::uint64_t> m_next_queue;
+
+  /// Number of tasks not yet picked up by a worker thread.
+  std::atomic<std::uint64_t> m_queued;
+
+  /// Number of tasks submitted but not yet finished.
+  std::atomic<std::uint64_t> m_pending;
+
+  /// Set on destruction to release the worker threads.
+  std::atomic<bool> m_stop;
+
+  std::mutex m_mutex;
+  std::condition_variable m_task_available;
+  std::condition_variable m_task_finished;
+};
@@ -0,0 +1,116 @@
+#include "trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+/// A single event of the Chrome trace format.
+struct event
+{
+  const char* name;
+  char phase;           ///< 'X' complete event of a scope, 'C' counter
+  std::uint64_t start;  ///< nanoseconds since the start of the program
+  std::uint64_t duration;
+  double value;
+};
+
+/// Events of a single thread.
+struct thread_buffer
+{
+  std::uint64_t thread_id;
+  std::vector<event> events;
+};
+
+const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<thread_buffer>> buffers;
+
+/// \return nanoseconds since the start of the program.
+std::uint64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+/// \return the buffer of the calling thread, which is registered on first use.
+thread_buffer& local_buffer()
+{
+  thread_local thread_buffer* buffer = nullptr;
+  if (buffer == nullptr)
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffers.emplace_back(new thread_buffer());
+    buffer = buffers.back().get();
+    buffer->thread_id = buffers.size();
+    buffer->events.reserve(4096);
+  }
+  return *buffer;
+}
+
+}; // namespace
+
+namespace trace {
+
+scope::scope(const char* _name)
+  : m_name(_name)
+  , m_start(now())
+{
+  /* empty */
+}
+
+scope::~scope()
+{
+  const event e = { m_name, 'X', m_start, now() - m_start, 0 };
+  local_buffer().events.push_back(e);
+}
+
+void counter(const char* _name, const double _value)
+{
+  const event e = { _name, 'C', now(), 0, _value };
+  local_buffer().events.push_back(e);
+}
+
+bool write(const std::string& _path)
+{
+  std::ofstream file(_path.c_str());
+  if (!file) { return false; }
+
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+
+  // timestamps of the Chrome trace format are in microseconds
+  file.precision(15);
+  file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  const char* separator = "\n";
+  for (const auto& buffer : buffers)
+  {
+    for (const event& e : buffer->events)
+    {
+      file
+        << separator << "{\"name\": \"" << e.name << "\", \"ph\": \"" << e.phase
+        << "\", \"pid\": 1, \"tid\": " << buffer->thread_id
+        << ", \"ts\": " << e.start * 1.0e-3;
+      if (e.phase == 'X') { file << ", \"dur\": " << e.duration * 1.0e-3; }
+      if (e.phase == 'C') { file << ", \"args\": {\"value\": " << e.value << "}"; }
+      file << "}";
+      separator = ",\n";
+    }
+  }
+  file << "\n]}\n";
+
+  return static_cast<bool>(file);
+}
+
+void clear()
+{
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  for (const auto& buffer : buffers)
+  {
+    buffer->events.clear();
+  }
+}
+
+}; // namespace trace
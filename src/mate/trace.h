@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/// Lightweight instrumentation of the hot paths. Scoped timers and counters are recorded into a
+/// buffer per thread and exported as a Chrome trace (JSON), which can be inspected in
+/// chrome://tracing or Perfetto.
+/// The instrumentation is only compiled in if MATE_TRACE is defined (build option
+/// CONFIG_ENABLE_TRACING). Otherwise the macros expand to nothing and cost nothing.
+namespace trace {
+
+/// Record the duration of the enclosing scope as a single event.
+class scope
+{
+public:
+  /// Start the timer.
+  /// \param _name name of the event, a string literal.
+  scope(const char* _name);
+
+  /// Stop the timer and record the event.
+  ~scope();
+
+private:
+  scope(const scope&);
+  scope& operator=(const scope&);
+
+  /// Name of the event.
+  const char* m_name;
+
+  /// Start time in nanoseconds since the start of the program.
+  std::uint64_t m_start;
+};
+
+/// Record the current value of a counter.
+/// \param _name name of the counter, a string literal.
+/// \param _value current value.
+void counter(const char* _name, const double _value);
+
+/// Write every recorded event in the Chrome trace format. Should be called after the traced work
+/// has finished, as the buffers of running threads are not synchronized.
+/// \param _path path of the JSON file.
+/// \return whether the file has been written.
+bool write(const std::string& _path);
+
+/// Discard every recorded event.
+void clear();
+
+}; // namespace trace
+
+#define MATE_TRACE_CONCATENATE_DETAIL(_a, _b) _a##_b
+#define MATE_TRACE_CONCATENATE(_a, _b) MATE_TRACE_CONCATENATE_DETAIL(_a, _b)
+
+#ifdef MATE_TRACE
+/// Time the enclosing scope.
+#define MATE_TRACE_SCOPE(_name) ::trace::scope MATE_TRACE_CONCATENATE(trace_scope_, __LINE__)(_name)
+/// Record the current value of a counter.
+#define MATE_TRACE_COUNTER(_name, _value) ::trace::counter(_name, static_cast<double>(_value))
+#else
+#define MATE_TRACE_SCOPE(_name) do {} while (0)
+#define MATE_TRACE_COUNTER(_name, _value) do {} while (0)
+#endif
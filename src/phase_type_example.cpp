@@ -0,0 +1,172 @@
+// Phase-type approximation of the machine model of the proxel example: a machine alternates
+// between a high performance mode (HPM), which overheats after a weibull distributed time, and a
+// low performance mode (LPM), which cools down after a uniformly distributed time. Both activities
+// are replaced by acyclic phase-type distributions, the resulting CTMC is solved by a markov_chain
+// and the probability of HPM over time is compared against a dense proxel solution.
+//
+// usage: phase_type_example [<delta_t of the proxel reference>]
+
+#include "hazard_rate.h"
+#include "markov_chain.h"
+#include "phase_type.h"
+#include "stepper.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const double end_time = 50;
+
+double overheat(const double _age) { return hazard_rate::weibull(_age, 55, 4); }
+double cooldown(const double _age) { return hazard_rate::uniform(_age, 9, 11); }
+
+double seconds_since(const std::chrono::steady_clock::time_point& _start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+/// Solve the model with proxels of the given time step. Every (state, age) pair is stored densely
+/// and nothing is pruned.
+/// \return the probability of HPM at each full time unit.
+std::vector<double> proxel_reference(const double _delta_t)
+{
+  const std::uint64_t steps = static_cast<std::uint64_t>(std::floor(end_time / _delta_t + 0.5));
+  const std::uint64_t steps_per_unit = static_cast<std::uint64_t>(std::floor(1 / _delta_t + 0.5));
+
+  std::vector<double> current[2] = { std::vector<double>(steps + 2, 0.0), std::vector<double>(steps + 2, 0.0) };
+  std::vector<double> next[2] = { std::vector<double>(steps + 2, 0.0), std::vector<double>(steps + 2, 0.0) };
+  double (*const hazard[2])(double) = { overheat, cooldown };
+
+  std::vector<double> result(1, 1.0);
+  current[0][0] = 1.0;
+  for (std::uint64_t k = 1; k <= steps; k++)
+  {
+    for (int s = 0; s < 2; s++) { std::fill(next[s].begin(), next[s].begin() + k + 1, 0.0); }
+
+    for (int s = 0; s < 2; s++)
+    {
+      for (std::uint64_t age = 0; age < k; age++)
+      {
+        const double value = current[s][age];
+        if (value == 0) { continue; }
+
+        const double z = _delta_t * hazard[s](age * _delta_t);
+        if (z < 1.0)
+        {
+          next[1 - s][0] += value * z;
+          next[s][age + 1] += value * (1 - z);
+        }
+        else
+        {
+          next[1 - s][0] += value;
+        }
+      }
+    }
+    std::swap(current[0], next[0]);
+    std::swap(current[1], next[1]);
+
+    if (k % steps_per_unit == 0)
+    {
+      double hpm = 0;
+      for (std::uint64_t age = 0; age <= k; age++) { hpm += current[0][age]; }
+      result.push_back(hpm);
+    }
+  }
+
+  return result;
+}
+
+/// Solve the model as a CTMC of the phases of both activities.
+/// \return the probability of HPM at each full time unit.
+std::vector<double> phase_type_solution(const phase_type& _overheat, const phase_type& _cooldown)
+{
+  const std::uint64_t hpm = _overheat.phase_count();
+  const std::uint64_t lpm = _cooldown.phase_count();
+
+  // leaving the last phase of one mode enters the phases of the other
+  Eigen::MatrixXd generator_matrix = Eigen::MatrixXd::Zero(hpm + lpm, hpm + lpm);
+  generator_matrix.topLeftCorner(hpm, hpm) = _overheat.sub_generator();
+  generator_matrix.bottomRightCorner(lpm, lpm) = _cooldown.sub_generator();
+  generator_matrix.topRightCorner(hpm, lpm) = _overheat.exit_rates() * _cooldown.initial_phases();
+  generator_matrix.bottomLeftCorner(lpm, hpm) = _cooldown.exit_rates() * _overheat.initial_phases();
+
+  // the discretized chain needs a time step below the inverse of the largest rate
+  const double max_rate = (-generator_matrix.diagonal()).maxCoeff();
+  const std::uint64_t steps_per_unit = std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(max_rate / 0.5)), 1);
+  const std::uint64_t units = static_cast<std::uint64_t>(end_time);
+
+  Eigen::RowVectorXd initial_state = Eigen::RowVectorXd::Zero(hpm + lpm);
+  initial_state.head(hpm) = _overheat.initial_phases();
+  const markov_chain<> chain(
+    initial_state,
+    markov_chain<>::from_ctmc(generator_matrix, 1.0 / steps_per_unit),
+    std::vector<discrete_distribution>(hpm + lpm, discrete_distribution(1)));
+
+  std::vector<double> trajectory((units + 1) * (hpm + lpm));
+  stepper<markov_chain<> > engine(chain);
+  engine.run(units * steps_per_unit, -1, trajectory.data(), units + 1, steps_per_unit);
+
+  std::vector<double> result(units + 1);
+  for (std::uint64_t t = 0; t <= units; t++)
+  {
+    result[t] = Eigen::Map<const Eigen::RowVectorXd>(&trajectory[t * (hpm + lpm)], hpm).sum();
+  }
+  return result;
+}
+
+}; // namespace
+
+int main(int argc, char* argv[])
+{
+  const double delta_t = (argc > 1) ? std::atof(argv[1]) : 0.01;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const std::vector<double> reference = proxel_reference(delta_t);
+  const double reference_seconds = seconds_since(start);
+
+  double mean;
+  double scv;
+  phase_type::moments(overheat, mean, scv);
+  std::cout << "overheat: mean " << mean << ", scv " << scv << std::endl;
+  phase_type::moments(cooldown, mean, scv);
+  std::cout << "cooldown: mean " << mean << ", scv " << scv << std::endl;
+  std::cout << "proxel reference (delta_t " << delta_t << "): " << reference_seconds * 1000 << " ms" << std::endl << std::endl;
+
+  std::cout << std::setw(10) << "phases" << std::setw(10) << "states"
+    << std::setw(16) << "max error" << std::setw(16) << "mean error"
+    << std::setw(12) << "ms" << std::setw(12) << "speedup" << std::endl;
+
+  for (const std::uint64_t max_phases : { 1, 2, 5, 10, 20, 50, 100, 300 })
+  {
+    start = std::chrono::steady_clock::now();
+    const phase_type overheat_phases = phase_type::fit(overheat, max_phases);
+    const phase_type cooldown_phases = phase_type::fit(cooldown, max_phases);
+    const std::vector<double> solution = phase_type_solution(overheat_phases, cooldown_phases);
+    const double seconds = seconds_since(start);
+
+    double max_error = 0;
+    double mean_error = 0;
+    for (std::uint64_t t = 0; t < solution.size() && t < reference.size(); t++)
+    {
+      const double error = std::fabs(solution[t] - reference[t]);
+      max_error = std::max(max_error, error);
+      mean_error += error / solution.size();
+    }
+
+    std::cout << std::setw(10) << max_phases
+      << std::setw(10) << overheat_phases.phase_count() + cooldown_phases.phase_count()
+      << std::setw(16) << max_error << std::setw(16) << mean_error
+      << std::setw(12) << seconds * 1000 << std::setw(12) << reference_seconds / seconds << std::endl;
+  }
+
+  return 0;
+}
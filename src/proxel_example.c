@@ -21,18 +21,37 @@
 #define LPM        2
 #define WP         0 /* (emission) working part */
 #define DP         1 /* (emission) defective part */
+#define PI         3.1415926
+#define NSTATES    3 /* number of discrete states of the SPN */
+
+/* configuration, can be overridden by the build (e.g. -DNORMALIZE=1) */
+#ifndef DELTA
 #define DELTA      1
+#endif
+#ifndef ENDTIME
 #define ENDTIME    50
-#define PI         3.1415926
+#endif
+#ifndef EMISSION
 #define EMISSION   1 /* 1 = active */
+#endif
+#ifndef RICHARDSON
+#define RICHARDSON 0 /* 1 = extrapolate from DELTA and DELTA/2 */
+#endif
+#ifndef NORMALIZE
+#define NORMALIZE  0 /* 1 = propagate conditional probabilities */
+#endif
+#ifndef NAGES
+#define NAGES      2 /* number of supplementary variables (ages) */
+#endif
 
 typedef struct tproxel *pproxel;
 
+typedef unsigned long long proxelkey;
+
 typedef struct tproxel {
-  int     id;                  /* unique proxel id for searching    */
+  proxelkey id;                /* unique proxel id for searching    */
   int     s;                   /* discrete state of SPN             */
-  int     tau1k;               /* first supplementary variable      */
-  int     tau2k;               /* second supplementary variable     */
+  int     tauk[NAGES];         /* supplementary variables (ages)    */
   double  val;                 /* proxel probability                */
   pproxel left, right;         /* pointers to child proxels in tree */
 } proxel;
@@ -40,6 +59,8 @@ typedef struct tproxel {
 double *y[3];                  /* vectors for storing solution      */
 double  tmax;                  /* maximum simulation time           */
 int     TAUMAX;                /* maximum simulation steps          */
+int     agebits[NAGES];        /* key width of each age in bits     */
+int     statebits;             /* key width of the state in bits    */
 int     totcnt;                /* counts total proxels processed    */
 int     maxccp;                /* counts max # concurrent proxels   */
 int     ccpcnt;                /* counts concurrent proxels         */
@@ -51,6 +72,10 @@ double  dt;                    /* delta time (DELTA)                */
 int     e;                     /* flag to forward emissio           */
 double *em[3];                 /* emission matrix                   */
 double *emsum[2];              /* symbol emission sum per timestep  */
+double *emlog;                 /* log-likelihood of the sequence    */
+double  stepsum = 0;           /* sum of the proxels of a time step */
+double *yerr[3];               /* error estimates of the solution   */
+double *emerr[2];              /* error estimates of emission sums  */
 int    *emsequence;            /* symbol emission sequence          */
 int    *empaths[5];            /* most likely generating paths      */
 
@@ -256,8 +281,8 @@ char* printemission(int e) {
 
 /* print a proxel */
 void printproxel(proxel *c) {
-  int left = 0;
-  int right = 0;
+  proxelkey left = 0;
+  proxelkey right = 0;
   
   if (c->left != NULL) {
     left = c->left->id;
@@ -269,7 +294,7 @@ void printproxel(proxel *c) {
   
   int leaf = (c->left == NULL && c->right == NULL);
   
-  printf("ID: %6i - %s - Age: %3d - Prob.: %7.5le - Leaf: %i (%i,%i)\n", c->id, printstate(c->s), c->tau1k, c->val, leaf, left, right);
+  printf("ID: %6llu - %s - Age: %3d - Prob.: %7.5le - Leaf: %i (%llu,%llu)\n", c->id, printstate(c->s), c->tauk[0], c->val, leaf, left, right);
 }
 
 /* print all proxels of a proxel tree */
@@ -302,7 +327,14 @@ void plotsolution(int kmax) {
   }
   printf("\n");
 
-  if (e) {
+  if (e && NORMALIZE) {
+    printf("Conditional Sequence Probabilities:\n");
+    for (k = 1; k <= kmax; k++) {
+      printf("Time: %6.2f - %s-Prob.: %7.5le - Log-Likelihood: %7.5le\n", k*dt, printemission(emsequence[k]), emsum[emsequence[k]][k], emlog[k]);
+    }
+    printf("\n");
+  }
+  else if (e) {
     printf("Sequence Probabilities:\n");
     for (k = 1; k <= kmax; k++) {
       printf("Time: %6.2f - %s-Prob.: %7.5le\n", k*dt, printemission(emsequence[k]), emsum[emsequence[k]][k]);
@@ -311,6 +343,27 @@ void plotsolution(int kmax) {
   }
 }
 
+/* print the error estimates of the extrapolated solution */
+void ploterror(int kmax) {
+  int k;
+  char* one = (e) ? printemission(WP) : printstate(HPM);
+  char* two = (e) ? printemission(DP) : printstate(LPM);
+
+  printf("%s/%s Error Estimates:\n", one, two);
+  for (k = 1; k <= kmax; k++) {
+    printf("Time: %6.2f - %s-Error: %7.5le - %s-Error: %7.5le\n", k*dt, one, yerr[0][k], two, yerr[2][k]);
+  }
+  printf("\n");
+
+  if (e) {
+    printf("Sequence Error Estimates:\n");
+    for (k = 1; k <= kmax; k++) {
+      printf("Time: %6.2f - %s-Error: %7.5le\n", k*dt, printemission(emsequence[k]), emerr[emsequence[k]][k]);
+    }
+    printf("\n");
+  }
+}
+
 /* count leafs of a proxel tree */
 int countleafs(proxel *p) {
   if (p == NULL) {
@@ -333,13 +386,68 @@ int size(proxel *p) {
   return size(p->left) + size(p->right) + 1;
 }
 
+/* print the statistics of the last run of solve(), which resets them */
+void printstatistics() {
+  printf("Statistics (DELTA = %g):\n", dt);
+  printf("Tree Size = %d\n", size(root[sw]));
+  printf("Proxels (Max Concurrent) = %d\n", maxccp);
+  printf("Proxels (Total) = %d\n", totcnt);
+  printf("Leafs (Total) = %i\n", countleafs(root[sw]));
+  printf("Accumulated Error = %7.5le\n", eerror);
+  printf("\n");
+}
+
 /********************************************************/
 /* proxel manipulation functions			                  */
 /********************************************************/
 
-/* compute unique id from proxel state */
-int state2id(int s, int t1k, int t2k) {
-  return(TAUMAX*(TAUMAX*s + t1k) + t2k);
+/* number of bits needed to store values from 0 to n - 1 */
+int bitwidth(int n) {
+  int bits = 0;
+
+  while ((1LL << bits) < n)
+    bits++;
+
+  return bits;
+}
+
+/* compute the key widths, the key is packed from the state followed by all ages */
+int initkeys(int taumax) {
+  int i, total;
+
+  statebits = bitwidth(NSTATES);
+  total = statebits;
+  for (i = 0; i < NAGES; i++) {
+    agebits[i] = bitwidth(taumax);
+    total += agebits[i];
+  }
+
+  if (total > 64) {
+    printf("proxel key of %d bits does not fit into 64 bits\n", total);
+    return 0;
+  }
+
+  return 1;
+}
+
+/* compute unique id from proxel state, ages are packed with a variable width each */
+proxelkey state2id(int s, const int *tauk) {
+  proxelkey id = (proxelkey)s;
+  int i;
+
+  for (i = 0; i < NAGES; i++)
+    id = (id << agebits[i]) | (proxelkey)tauk[i];
+
+  return id;
+}
+
+/* free all proxels of a proxel tree */
+void freetree(proxel *p) {
+  if (p == NULL)
+    return;
+  freetree(p->left);
+  freetree(p->right);
+  free(p);
 }
 
 /* returns a proxel from the tree */
@@ -408,8 +516,9 @@ proxel *getproxel()
 }
 
 /* get a fresh proxel and copy data into it */
-proxel *insertproxel(int s, int tau1k, int tau2k, double val) {
+proxel *insertproxel(int s, const int *tauk, double val) {
   proxel *temp;
+  int i;
 
   /* create new proxel or grab one from free list */
   if (firstfree == NULL)
@@ -419,10 +528,10 @@ proxel *insertproxel(int s, int tau1k, int tau2k, double val) {
     firstfree = firstfree->right;
   }
   /* copy values */
-  temp->id = state2id(s, tau1k, tau2k);
+  temp->id = state2id(s, tauk);
   temp->s = s;
-  temp->tau1k = tau1k;
-  temp->tau2k = tau2k;
+  for (i = 0; i < NAGES; i++)
+    temp->tauk[i] = tauk[i];
   temp->val = val;
   ccpcnt += 1;
   if (maxccp < ccpcnt) {
@@ -433,27 +542,31 @@ proxel *insertproxel(int s, int tau1k, int tau2k, double val) {
   return(temp);
 }
 
-/* adds a new proxel to the tree */
-void addproxel(int s, int tau1k, int tau2k, double val) {
+/* adds a new proxel to the tree, only reachable combinations of ages are ever stored */
+void addproxel(int s, const int *tauk, double val) {
   proxel *temp, *temp2;
-  int cont = 1, id;
+  int cont = 1, i;
+  int ages[NAGES];
+  proxelkey id;
+
+  stepsum += val;
 
   /* Alarm! TAUMAX overstepped! */
-  if (tau1k >= TAUMAX) {
-    //  printf(">>> %3d %3d %3d %7.5le \n", s, tau1k, val, TAUMAX);
-    tau1k = TAUMAX - 1;
+  for (i = 0; i < NAGES; i++) {
+    ages[i] = (tauk[i] >= TAUMAX) ? TAUMAX - 1 : tauk[i];
   }
+  tauk = ages;
 
   /* New tree, add root */
   if (root[sw] == NULL) {
-    root[sw] = insertproxel(s, tau1k, tau2k, val);
+    root[sw] = insertproxel(s, tauk, val);
     root[sw]->left = NULL;
     root[sw]->right = NULL;
     return;
   }
 
   /* compute id of new proxel */
-  id = state2id(s, tau1k, tau2k);
+  id = state2id(s, tauk);
 
   /* Locate insertion point in tree */
   temp = root[sw];
@@ -469,7 +582,7 @@ void addproxel(int s, int tau1k, int tau2k, double val) {
 
   /* Insert left leaf into tree */
   if ((temp->left == NULL) && (id < temp->id)) {
-    temp2 = insertproxel(s, tau1k, tau2k, val);
+    temp2 = insertproxel(s, tauk, val);
     temp->left = temp2;
     temp2->left = NULL;
     temp2->right = NULL;
@@ -478,7 +591,7 @@ void addproxel(int s, int tau1k, int tau2k, double val) {
 
   /* Insert right leaf into tree */
   if ((temp->right == NULL) && (id > temp->id)) {
-    temp2 = insertproxel(s, tau1k, tau2k, val);
+    temp2 = insertproxel(s, tauk, val);
     temp->right = temp2;
     temp2->left = NULL;
     temp2->right = NULL;
@@ -527,33 +640,10 @@ double emission(int t, int from, int to, double p, int o) {
 /*  main processing loop                                */
 /********************************************************/
 
-int main(int argc, char **argv) {
-  int     k, j, kmax;
-  proxel *currproxel;
-  double  val, z, valhpm, vallpm;
-  int     s, tau1k, tau2k;
-
-  /* initialise the simulation */
-  root[0] = NULL;
-  root[1] = NULL;
-  eerror = 0.0;
-  totcnt = 0;
-  maxccp = 0;
-  double tmax = ENDTIME;
-  dt = DELTA;
-  e = EMISSION;
-
-  if (e) {
-    printf("Using Symbol Emission...\n\n");
-  }
-  else {
-    printf("No Symbol Emission...\n\n");
-  }
-
-  kmax = (int)floor(tmax / dt + 0.5);
-  TAUMAX = kmax;
+/* allocate the zeroed solution vectors of kmax time steps */
+void initsolution(int kmax) {
+  int k, j;
 
-  /* initialize the solution vector for each time step */
   for (k = 0; k < 3; k++) {
     y[k] = malloc(sizeof(double) * (kmax + 2));
     for (j = 0; j < kmax + 2; j++)
@@ -561,19 +651,6 @@ int main(int argc, char **argv) {
   }
 
   if (e) {
-    for (k = 0; k < 3; k++) { /* rows */
-      em[k] = malloc(sizeof(double) * 2);
-      for (j = 0; j < 2; j++) { /* cols */
-        em[k][j] = 0.0;
-      }
-    }
-    em[HPM][WP] = 0.95;
-    em[HPM][DP] = 0.05;
-    em[LPM][WP] = 0.8;
-    em[LPM][DP] = 0.2;
-    printf("Emission Matrix:\nHPM->WP: %11.10f\nHPM->DP: %11.10f\nLPM->WP: %11.10f\nLPM->DP: %11.10f\n\n", em[HPM][WP], em[HPM][DP], em[LPM][WP], em[LPM][DP]);
-
-    /* initialize the emission sum vector */
     for (k = 0; k < 2; k++) { /* cols */
       emsum[k] = malloc(sizeof(double) * (kmax + 2));
       for (j = 0; j < kmax + 2; j++) {
@@ -581,29 +658,49 @@ int main(int argc, char **argv) {
       }
     }
 
-    /* initialize the emission sequence */
-    emsequence = malloc(sizeof(int) * (kmax + 2));
-    for (k = 1; k < kmax + 2; ++k) {
-      if (k % 2 == 0) {
-        emsequence[k] = WP;
-      }
-      else {
-        emsequence[k] = DP;
-      }
-      emsequence[k] = WP;
+    emlog = malloc(sizeof(double) * (kmax + 2));
+    for (j = 0; j < kmax + 2; j++) {
+      emlog[j] = 0.0;
     }
-    printemissionsequence(kmax);
+  }
+}
 
-    /* initialize the most likely paths */
-    for (k = 0; k < 5; k++) {
-      empaths[k] = malloc(sizeof(int) * (kmax + 2));
-      for (j = 0; j < kmax + 2; j++)
-        empaths[k][j] = 0;
-    }
+/* solve kmax time steps of size dt, a symbol is emitted in every stride-th time step only.
+   With NORMALIZE, the proxels of each time step are divided by their sum before they are
+   propagated, so they hold the state distribution conditioned on the emissions so far, emsum[]
+   holds the conditional probability of each symbol and emlog[] the log-likelihood of the
+   sequence. Proxels are pruned relative to the conditional distribution, which keeps pruning
+   effective on arbitrarily long sequences. */
+int solve(int kmax, int stride) {
+  int     k, i, emit;
+  proxel *currproxel;
+  double  val, z, valhpm, vallpm;
+  double  scale, loglik = 0.0;
+  int     s, tau1k;
+  int     aged[NAGES];           /* ages if the enabled activity continues */
+  int     restart[NAGES];        /* ages after a change of state           */
+
+  /* start with an empty tree */
+  freetree(root[0]);
+  freetree(root[1]);
+  root[0] = NULL;
+  root[1] = NULL;
+  sw = 0;
+  ccpcnt = 0;
+  stepsum = 0.0;
+  eerror = 0.0;
+  totcnt = 0;
+  maxccp = 0;
+  TAUMAX = kmax;
+  if (!initkeys(TAUMAX)) {
+    return(0);
   }
 
   /* set initial proxel */
-  addproxel(HPM, 0, 0, 1.0);
+  for (i = 0; i < NAGES; i++) {
+    restart[i] = 0;
+  }
+  addproxel(HPM, restart, 1.0);
 
   /* first loop: iteration over all time steps*/
   /* current model time is k*dt */
@@ -616,73 +713,87 @@ int main(int argc, char **argv) {
     } */
     
     sw = 1 - sw;
+    emit = e && (k % stride == 0);
+
+    /* scale of the proxels of the last time step, the likelihood of its emission */
+    scale = (NORMALIZE && stepsum > 0.0) ? stepsum : 1.0;
+    stepsum = 0.0;
+    if (NORMALIZE && e && ((k - 1) % stride == 0)) {
+      loglik += log(scale);
+      emlog[(k - 1) / stride] = loglik;
+    }
 
     /* second loop: iterating over all proxels of a time step */
     while (root[1 - sw] != NULL)
     {
       totcnt++;
       currproxel = getproxel();
-      while ((currproxel->val < MINPROB) && (root[1 - sw] != NULL)) {
-        val = currproxel->val;
+      while ((currproxel->val < MINPROB * scale) && (root[1 - sw] != NULL)) {
+        val = currproxel->val / scale;
         eerror += val;
         currproxel = getproxel();
       }
-      val = currproxel->val;
-      tau1k = currproxel->tau1k;
-      tau2k = currproxel->tau2k;
+      val = currproxel->val / scale;
+      tau1k = currproxel->tauk[0];
       s = currproxel->s;
       y[s][k - 1] += val;
 
+      /* every age of a concurrently enabled activity advances, the machine model only uses the first */
+      for (i = 0; i < NAGES; i++) {
+        aged[i] = currproxel->tauk[i];
+      }
+      aged[0] += 1;
+
       /* create child proxels */
       switch (s) {
       case HPM:
         /* probability to overheat the machine */
         z = dt * overheat(tau1k*dt);
         if (z < 1.0) {
-          if (e) {
-            vallpm = emission(k, s, LPM, val*z, emsequence[k]);
-            valhpm = emission(k, s, HPM, val*(1 - z), emsequence[k]);
+          if (emit) {
+            vallpm = emission(k / stride, s, LPM, val*z, emsequence[k / stride]);
+            valhpm = emission(k / stride, s, HPM, val*(1 - z), emsequence[k / stride]);
           }
           else {
             vallpm = val*z;
             valhpm = val*(1 - z);
           }
-          addproxel(LPM, 0, 0, vallpm);
-          addproxel(HPM, tau1k + 1, 0, valhpm);
+          addproxel(LPM, restart, vallpm);
+          addproxel(HPM, aged, valhpm);
         }
         else {
-          if (e) {
-            vallpm = emission(k, s, LPM, val, emsequence[k]);
+          if (emit) {
+            vallpm = emission(k / stride, s, LPM, val, emsequence[k / stride]);
           }
           else {
             vallpm = val;
           }
-          addproxel(LPM, 0, 0, vallpm);
+          addproxel(LPM, restart, vallpm);
         }
         break;
       case LPM:
         /* probability to cooldown the machine */
         z = dt * cooldown(tau1k*dt);
         if (z < 1.0) {
-          if (e) {
-            valhpm = emission(k, s, HPM, val*z, emsequence[k]);
-            vallpm = emission(k, s, LPM, val*(1 - z), emsequence[k]);
+          if (emit) {
+            valhpm = emission(k / stride, s, HPM, val*z, emsequence[k / stride]);
+            vallpm = emission(k / stride, s, LPM, val*(1 - z), emsequence[k / stride]);
           }
           else {
             valhpm = val*z;
             vallpm = val*(1 - z);
           }
-          addproxel(HPM, 0, 0, valhpm);
-          addproxel(LPM, tau1k + 1, 0, vallpm);
+          addproxel(HPM, restart, valhpm);
+          addproxel(LPM, aged, vallpm);
         }
         else {
-          if (e) {
-            valhpm = emission(k, s, HPM, val, emsequence[k]);
+          if (emit) {
+            valhpm = emission(k / stride, s, HPM, val, emsequence[k / stride]);
           }
           else {
             valhpm = val;
           } 
-          addproxel(HPM, 0, 0, valhpm);
+          addproxel(HPM, restart, valhpm);
         }
         break;
       default:
@@ -692,6 +803,123 @@ int main(int argc, char **argv) {
     }
   }
 
+  return(1);
+}
+
+/* combine the coarse solution with the fine solution of half the time step by richardson
+   extrapolation. The solver is of first order, so 2 * fine - coarse cancels the leading error
+   term and fine - coarse estimates the remaining error of the fine solution. */
+void extrapolate(int kmax, double **ycoarse, double **emcoarse) {
+  int k, j;
+
+  for (k = 0; k < 3; k++) {
+    yerr[k] = malloc(sizeof(double) * (kmax + 2));
+    for (j = 0; j < kmax + 2; j++) {
+      yerr[k][j] = (j <= kmax) ? y[k][2 * j] - ycoarse[k][j] : 0.0;
+      ycoarse[k][j] += 2 * yerr[k][j];
+    }
+    free(y[k]);
+    y[k] = ycoarse[k];
+  }
+
+  if (e) {
+    for (k = 0; k < 2; k++) {
+      emerr[k] = malloc(sizeof(double) * (kmax + 2));
+      for (j = 0; j < kmax + 2; j++) {
+        emerr[k][j] = emsum[k][j] - emcoarse[k][j];
+        emcoarse[k][j] += 2 * emerr[k][j];
+      }
+      free(emsum[k]);
+      emsum[k] = emcoarse[k];
+    }
+  }
+}
+
+
+int main(int argc, char **argv) {
+  int     k, j, kmax;
+  double *ycoarse[3];            /* solution of the coarse time step       */
+  double *emcoarse[2];           /* emission sums of the coarse time step  */
+
+  /* initialise the simulation */
+  root[0] = NULL;
+  root[1] = NULL;
+  double tmax = ENDTIME;
+  dt = DELTA;
+  e = EMISSION;
+
+  if (e) {
+    printf("Using Symbol Emission...\n\n");
+  }
+  else {
+    printf("No Symbol Emission...\n\n");
+  }
+
+  kmax = (int)floor(tmax / dt + 0.5);
+
+  if (e) {
+    for (k = 0; k < 3; k++) { /* rows */
+      em[k] = malloc(sizeof(double) * 2);
+      for (j = 0; j < 2; j++) { /* cols */
+        em[k][j] = 0.0;
+      }
+    }
+    em[HPM][WP] = 0.95;
+    em[HPM][DP] = 0.05;
+    em[LPM][WP] = 0.8;
+    em[LPM][DP] = 0.2;
+    printf("Emission Matrix:\nHPM->WP: %11.10f\nHPM->DP: %11.10f\nLPM->WP: %11.10f\nLPM->DP: %11.10f\n\n", em[HPM][WP], em[HPM][DP], em[LPM][WP], em[LPM][DP]);
+
+    /* initialize the emission sequence */
+    emsequence = malloc(sizeof(int) * (kmax + 2));
+    for (k = 1; k < kmax + 2; ++k) {
+      if (k % 2 == 0) {
+        emsequence[k] = WP;
+      }
+      else {
+        emsequence[k] = DP;
+      }
+      emsequence[k] = WP;
+    }
+    printemissionsequence(kmax);
+
+    /* initialize the most likely paths */
+    for (k = 0; k < 5; k++) {
+      empaths[k] = malloc(sizeof(int) * (kmax + 2));
+      for (j = 0; j < kmax + 2; j++)
+        empaths[k][j] = 0;
+    }
+  }
+
+  /* initialize the solution vector and the emission sum vector for each time step */
+  initsolution(kmax);
+
+  if (!solve(kmax, 1)) {
+    return(1);
+  }
+  printstatistics();
+
+  if (RICHARDSON) {
+    /* keep the coarse solution, the fine solution emits only at the coarse time steps */
+    for (k = 0; k < 3; k++)
+      ycoarse[k] = y[k];
+    for (k = 0; k < 2; k++)
+      emcoarse[k] = emsum[k];
+
+    dt = DELTA / 2.0;
+    if (e) {
+      free(emlog);
+    }
+    initsolution(2 * kmax);
+    if (!solve(2 * kmax, 2)) {
+      return(1);
+    }
+    printstatistics();
+
+    dt = DELTA;
+    extrapolate(kmax, ycoarse, emcoarse);
+  }
+
   /*
   printf("\n");
   printtree(root[sw]);
@@ -699,12 +927,9 @@ int main(int argc, char **argv) {
   */
 
   plotsolution(kmax);
-
-  printf("Tree Size = %d\n", size(root[sw]));
-  printf("Proxels (Max Concurrent) = %d\n", maxccp);
-  printf("Proxels (Total) = %d\n", totcnt);
-  printf("Leafs (Total) = %i\n", countleafs(root[sw]));
-  printf("Accumulated Error = %7.5le\n", eerror);
+  if (RICHARDSON) {
+    ploterror(kmax);
+  }
 
   printf("\n"); // last carriage return before exit
 
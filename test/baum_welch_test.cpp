@@ -0,0 +1,60 @@
+// Baum-Welch training never decreases the log-likelihood of the training sequences. A sequence,
+// which is impossible under the model, stops the training after the first iteration without
+// modifying the model, instead of iterating on a log-likelihood that is not a number.
+
+#include "baum_welch.h"
+#include "check.h"
+#include "markov_chain.h"
+#include "thread_pool.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+/// \return a two state chain, whose first state never emits the second symbol.
+markov_chain<> model()
+{
+  const Eigen::RowVectorXd initial_state = (Eigen::RowVectorXd(2) << 1.0, 0.0).finished();
+  const Eigen::MatrixXd transitions = (Eigen::MatrixXd(2, 2) << 0.6, 0.4, 0.3, 0.7).finished();
+  std::vector<discrete_distribution> emissions;
+  emissions.push_back(discrete_distribution((Eigen::VectorXd(3) << 0.5, 0.0, 0.5).finished()));
+  emissions.push_back(discrete_distribution((Eigen::VectorXd(3) << 0.2, 0.5, 0.3).finished()));
+  return markov_chain<>(initial_state, transitions, emissions);
+}
+
+}; // namespace
+
+int main()
+{
+  thread_pool pool(2);
+
+  std::vector<std::vector<std::uint64_t>> sequences;
+  sequences.push_back({ 0, 2, 1, 1, 0, 2, 2, 1, 0 });
+  sequences.push_back({ 2, 1, 1, 1, 0, 0, 2 });
+  sequences.push_back({ 0, 1, 2, 1, 0 });
+
+  markov_chain<> trained = model();
+  const std::vector<baum_welch::iteration> iterations = baum_welch(trained, pool).train(sequences, 50, 1.0e-9);
+  MATE_CHECK(!iterations.empty());
+  for (std::uint64_t i = 0; i < iterations.size(); i++)
+  {
+    MATE_CHECK(std::isfinite(iterations[i].log_likelihood));
+    if (i > 0) { MATE_CHECK(iterations[i].log_likelihood >= iterations[i - 1].log_likelihood - 1e-9); }
+  }
+
+  // every sequence starts in the first state, which cannot emit the second symbol
+  sequences.push_back({ 1, 0, 2 });
+  markov_chain<> impossible = model();
+  const std::vector<baum_welch::iteration> stopped = baum_welch(impossible, pool).train(sequences, 50, 1.0e-9);
+  MATE_CHECK(stopped.size() == 1);
+  MATE_CHECK(stopped.back().log_likelihood == -std::numeric_limits<double>::infinity());
+  MATE_CHECK(impossible.initial_state() == model().initial_state());
+  MATE_CHECK(impossible.transition_matrix() == model().transition_matrix());
+
+  return check_result();
+}
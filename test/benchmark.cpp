@@ -0,0 +1,474 @@
+// Microbenchmarks of the Mate library across several problem sizes. Reports the time and the
+// number of heap allocations per operation and the throughput, optionally writes the results as a
+// JSON baseline and compares them against a previous baseline.
+//
+// usage: benchmark [--json <output>] [--baseline <input>] [--tolerance <fraction>] [--filter <name>]
+//        [--trace <output>]
+//
+// The exit code is non-zero if any benchmark is slower than its baseline by more than the
+// tolerance (default 0.1) or allocates more often than before, or if any benchmark of an
+// allocation-free operation (stepper) allocates at all.
+// The Chrome trace of the run is only written if the library was built with CONFIG_ENABLE_TRACING.
+
+#include "discrete_distribution.h"
+#include "markov_chain.h"
+#include "protocol_loader.h"
+#include "random.h"
+#include "stepper.h"
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+// allocation counting
+// -------------------------------------------------------------------------------------------------
+
+namespace {
+
+std::atomic<std::uint64_t> allocation_count(0);
+
+}; // namespace
+
+#if defined(__GLIBC__)
+
+// Eigen allocates with std::malloc directly, so allocations are counted below operator new
+extern "C" {
+
+void* __libc_malloc(std::size_t _size);
+void* __libc_calloc(std::size_t _count, std::size_t _size);
+void* __libc_realloc(void* _pointer, std::size_t _size);
+
+void* malloc(std::size_t _size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(_size);
+}
+
+void* calloc(std::size_t _count, std::size_t _size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(_count, _size);
+}
+
+void* realloc(void* _pointer, std::size_t _size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(_pointer, _size);
+}
+
+}
+
+#else
+
+// only allocations of the standard library are counted, Eigen allocates with std::malloc
+void* operator new(std::size_t _size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* result = std::malloc(_size == 0 ? 1 : _size);
+  if (result == nullptr) { throw std::bad_alloc(); }
+  return result;
+}
+
+void* operator new[](std::size_t _size)
+{
+  return operator new(_size);
+}
+
+void operator delete(void* _pointer) noexcept
+{
+  std::free(_pointer);
+}
+
+void operator delete[](void* _pointer) noexcept
+{
+  std::free(_pointer);
+}
+
+#endif
+
+namespace {
+
+// -------------------------------------------------------------------------------------------------
+// measurement
+// -------------------------------------------------------------------------------------------------
+
+/// Result of a single benchmark at a single problem size.
+struct result
+{
+  std::string name;
+  std::uint64_t size;
+  double ns_per_op;
+  double allocations_per_op;
+  double items_per_second;
+};
+
+/// Minimum measured time of a benchmark.
+const double minimum_seconds = 0.2;
+
+/// Only benchmarks whose name contains the filter are measured.
+std::string name_filter;
+
+/// Silences the output of the library, e.g. of markov_chain::estimate(), while measuring.
+class silence
+{
+public:
+  silence() : m_output(std::cout.rdbuf(m_discard.rdbuf())) { /* empty */ }
+  ~silence() { std::cout.rdbuf(m_output); }
+
+private:
+  std::ostringstream m_discard;
+  std::streambuf* m_output;
+};
+
+/// Run the operation until the minimum time is reached, doubling the number of repetitions.
+/// \param _name name of the benchmark.
+/// \param _size problem size.
+/// \param _items items processed by a single operation, e.g. observations or bytes.
+/// \param _operation operation to measure.
+template<typename operation>
+result measure(const std::string& _name, const std::uint64_t _size, const double _items, operation _operation)
+{
+  result r;
+  r.name = _name;
+  r.size = _size;
+  r.ns_per_op = -1; // skipped
+  r.allocations_per_op = 0;
+  r.items_per_second = 0;
+  if (!name_filter.empty() && _name.find(name_filter) == std::string::npos) { return r; }
+
+  // warm up caches and lazily built tables
+  {
+    silence quiet;
+    _operation();
+  }
+
+  std::uint64_t repetitions = 1;
+  for (;;)
+  {
+    std::uint64_t allocations;
+    double seconds;
+    {
+      silence quiet;
+      const std::uint64_t first_allocation = allocation_count.load();
+      const auto begin = std::chrono::steady_clock::now();
+      for (std::uint64_t i = 0; i < repetitions; i++) { _operation(); }
+      const auto end = std::chrono::steady_clock::now();
+      allocations = allocation_count.load() - first_allocation;
+      seconds = std::chrono::duration<double>(end - begin).count();
+    }
+
+    if (seconds >= minimum_seconds || repetitions >= (std::uint64_t(1) << 40))
+    {
+      r.ns_per_op = seconds * 1.0e9 / repetitions;
+      r.allocations_per_op = static_cast<double>(allocations) / repetitions;
+      r.items_per_second = _items * repetitions / seconds;
+      return r;
+    }
+    repetitions *= 2;
+  }
+}
+
+/// Prevents the compiler from removing a computation whose result is unused.
+volatile double sink;
+
+// -------------------------------------------------------------------------------------------------
+// fixtures
+// -------------------------------------------------------------------------------------------------
+
+/// Random, dense transition matrix of the given number of states.
+Eigen::MatrixXd random_transition_matrix(const std::uint64_t _state_count)
+{
+  Eigen::MatrixXd result(_state_count, _state_count);
+  Eigen::VectorXd row(_state_count);
+  for (std::uint64_t i = 0; i < _state_count; i++)
+  {
+    math::fill_uniform(row);
+    result.row(i) = row.transpose() / row.sum();
+  }
+  return result;
+}
+
+/// Random markov chain of the given number of states with two symbols.
+markov_chain<> random_markov_chain(const std::uint64_t _state_count)
+{
+  return markov_chain<>(
+    Eigen::RowVectorXd::Ones(_state_count) / static_cast<double>(_state_count),
+    random_transition_matrix(_state_count),
+    std::vector<discrete_distribution>(_state_count, discrete_distribution(2)));
+}
+
+/// Random protocol in the text format.
+std::string random_protocol(const std::uint64_t _entry_count)
+{
+  std::string result;
+  char line[32];
+  for (std::uint64_t i = 0; i < _entry_count; i++)
+  {
+    const int length = std::snprintf(line, sizeof(line), "%llu %s\n",
+      static_cast<unsigned long long>(i + 1), math::random_int(2) ? "OK" : "D");
+    result.append(line, length);
+  }
+  return result;
+}
+
+// -------------------------------------------------------------------------------------------------
+// benchmarks
+// -------------------------------------------------------------------------------------------------
+
+void benchmark_markov_chain(std::vector<result>& _results)
+{
+  for (const std::uint64_t state_count : { 16, 128, 1024 })
+  {
+    markov_chain<> chain = random_markov_chain(state_count);
+    const std::uint64_t steps = 100;
+    _results.push_back(measure("markov_chain::estimate", state_count, steps, [&]() {
+      sink = chain.estimate(steps, -1)[0];
+    }));
+  }
+
+  for (const std::uint64_t state_count : { 16, 128, 512 })
+  {
+    markov_chain<> chain = random_markov_chain(state_count);
+    const std::uint64_t squarings = 4;
+    _results.push_back(measure("markov_chain::estimate_power", state_count, squarings, [&]() {
+      sink = chain.estimate_power(squarings, -1)[0];
+    }));
+  }
+
+  for (const std::uint64_t state_count : { 16, 128, 1024 })
+  {
+    const Eigen::MatrixXd generator_matrix = random_transition_matrix(state_count) - Eigen::MatrixXd::Identity(state_count, state_count);
+    _results.push_back(measure("markov_chain::from_ctmc", state_count, 1, [&]() {
+      sink = markov_chain<>::from_ctmc(generator_matrix, 0.1)(0, 0);
+    }));
+  }
+}
+
+void benchmark_stepper(std::vector<result>& _results)
+{
+  for (const std::uint64_t state_count : { 16, 128, 1024 })
+  {
+    markov_chain<> chain = random_markov_chain(state_count);
+    stepper<markov_chain<> > engine(chain);
+    const std::uint64_t steps = 100;
+    _results.push_back(measure("stepper::run", state_count, steps, [&]() {
+      engine.reset();
+      sink = static_cast<double>(engine.run(steps));
+    }));
+
+    const std::uint64_t every = 10;
+    std::vector<double> trajectory((steps / every + 1) * state_count);
+    _results.push_back(measure("stepper::run[trajectory]", state_count, steps, [&]() {
+      engine.reset();
+      sink = static_cast<double>(engine.run(steps, -1, trajectory.data(), steps / every + 1, every));
+    }));
+  }
+}
+
+void benchmark_discrete_distribution(std::vector<result>& _results)
+{
+  for (const std::uint64_t observation_count : { 2, 64, 4096 })
+  {
+    Eigen::VectorXd probabilities(observation_count);
+    math::fill_uniform(probabilities);
+    const discrete_distribution distribution(probabilities);
+
+    _results.push_back(measure("discrete_distribution::random", observation_count, 1, [&]() {
+      sink = distribution.random()[0];
+    }));
+
+    const std::uint64_t batch = 4096;
+    std::vector<std::uint64_t> observations(batch);
+    _results.push_back(measure("discrete_distribution::sample", observation_count, batch, [&]() {
+      distribution.sample(batch, observations.data());
+    }));
+
+    Eigen::VectorXd observation(1);
+    observation[0] = static_cast<double>(observation_count - 1);
+    _results.push_back(measure("discrete_distribution::probability", observation_count, 1, [&]() {
+      sink = distribution.probability(observation);
+    }));
+
+    std::vector<double> gathered(batch);
+    _results.push_back(measure("discrete_distribution::probability[batch]", observation_count, batch, [&]() {
+      distribution.probability(batch, observations.data(), gathered.data());
+    }));
+
+    Eigen::MatrixXd estimate_observations(1, batch);
+    for (std::uint64_t i = 0; i < batch; i++) { estimate_observations(0, i) = static_cast<double>(observations[i]); }
+    discrete_distribution estimated(observation_count);
+    _results.push_back(measure("discrete_distribution::estimate", observation_count, batch, [&]() {
+      estimated.estimate(estimate_observations);
+    }));
+  }
+}
+
+void benchmark_random(std::vector<result>& _results)
+{
+  _results.push_back(measure("math::random", 1, 1, []() { sink = math::random(); }));
+  _results.push_back(measure("math::random_normal", 1, 1, []() { sink = math::random_normal(); }));
+  _results.push_back(measure("math::random_int", 1, 1, []() { sink = math::random_int(1000); }));
+
+  for (const std::uint64_t size : { 64, 4096, 262144 })
+  {
+    Eigen::VectorXd values(size);
+    _results.push_back(measure("math::fill_uniform", size, static_cast<double>(size), [&]() {
+      math::fill_uniform(values);
+    }));
+    _results.push_back(measure("math::fill_normal", size, static_cast<double>(size), [&]() {
+      math::fill_normal(values);
+    }));
+  }
+}
+
+void benchmark_protocol_loader(std::vector<result>& _results)
+{
+  for (const std::uint64_t entry_count : { 1000, 100000, 1000000 })
+  {
+    const std::string protocol = random_protocol(entry_count);
+    protocol_loader loader;
+
+    // throughput in bytes
+    _results.push_back(measure("protocol_loader::read[istream]", entry_count, static_cast<double>(protocol.size()), [&]() {
+      std::istringstream stream(protocol);
+      sink = static_cast<double>(loader.read(stream).size());
+    }));
+
+    std::vector<order> entries;
+    entries.reserve(entry_count);
+    _results.push_back(measure("protocol_loader::parse", entry_count, static_cast<double>(protocol.size()), [&]() {
+      entries.clear();
+      protocol_loader::parse(protocol.data(), protocol.data() + protocol.size(), entries);
+    }));
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+// baselines
+// -------------------------------------------------------------------------------------------------
+
+/// Write the results as JSON, one benchmark per line.
+void write_json(const std::string& _path, const std::vector<result>& _results)
+{
+  std::ofstream file(_path.c_str());
+  file.precision(10);
+  file << "[";
+  const char* separator = "\n";
+  for (const result& r : _results)
+  {
+    if (r.ns_per_op < 0) { continue; }
+    file
+      << separator << "  {\"name\": \"" << r.name << "\", \"size\": " << r.size
+      << ", \"ns_per_op\": " << r.ns_per_op
+      << ", \"allocations_per_op\": " << r.allocations_per_op
+      << ", \"items_per_second\": " << r.items_per_second
+      << "}";
+    separator = ",\n";
+  }
+  file << "\n]\n";
+}
+
+/// Read results written by write_json().
+std::vector<result> read_json(const std::string& _path)
+{
+  std::vector<result> results;
+  std::ifstream file(_path.c_str());
+  for (std::string line; std::getline(file, line); )
+  {
+    const std::string::size_type begin = line.find("\"name\": \"");
+    if (begin == std::string::npos) { continue; }
+    const std::string::size_type end = line.find('"', begin + 9);
+
+    result r;
+    r.name = line.substr(begin + 9, end - begin - 9);
+    unsigned long long size = 0;
+    if (std::sscanf(line.c_str() + end,
+      "\", \"size\": %llu, \"ns_per_op\": %lf, \"allocations_per_op\": %lf, \"items_per_second\": %lf",
+      &size, &r.ns_per_op, &r.allocations_per_op, &r.items_per_second) == 4)
+    {
+      r.size = size;
+      results.push_back(r);
+    }
+  }
+  return results;
+}
+
+}; // namespace
+
+int main(int argc, char* argv[])
+{
+  std::string json;
+  std::string baseline;
+  std::string trace_path;
+  double tolerance = 0.1;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    const std::string option = argv[i];
+    if (option == "--json") { json = argv[i + 1]; }
+    else if (option == "--baseline") { baseline = argv[i + 1]; }
+    else if (option == "--tolerance") { tolerance = std::atof(argv[i + 1]); }
+    else if (option == "--filter") { name_filter = argv[i + 1]; }
+    else if (option == "--trace") { trace_path = argv[i + 1]; }
+  }
+
+  math::seed(42);
+
+  std::vector<result> results;
+  benchmark_markov_chain(results);
+  benchmark_stepper(results);
+  benchmark_discrete_distribution(results);
+  benchmark_random(results);
+  benchmark_protocol_loader(results);
+
+  std::vector<result> previous;
+  if (!baseline.empty()) { previous = read_json(baseline); }
+
+  int regressions = 0;
+  std::printf("%-42s %10s %14s %12s %14s %10s\n", "benchmark", "size", "ns/op", "allocs/op", "items/s", "change");
+  for (const result& r : results)
+  {
+    if (r.ns_per_op < 0) { continue; }
+
+    std::string change;
+    if (r.name.compare(0, 9, "stepper::") == 0 && r.allocations_per_op > 0)
+    {
+      change = "ALLOCATES";
+      regressions++;
+    }
+    for (const result& p : previous)
+    {
+      if (p.name != r.name || p.size != r.size) { continue; }
+
+      char text[32];
+      const double ratio = r.ns_per_op / p.ns_per_op - 1;
+      std::snprintf(text, sizeof(text), "%+.1f%%", ratio * 100);
+      if (!change.empty()) { change += " "; }
+      change += text;
+      if (ratio > tolerance || r.allocations_per_op > p.allocations_per_op)
+      {
+        change += " REGRESSION";
+        regressions++;
+      }
+    }
+
+    std::printf("%-42s %10llu %14.1f %12.2f %14.4g %10s\n",
+      r.name.c_str(), static_cast<unsigned long long>(r.size), r.ns_per_op, r.allocations_per_op, r.items_per_second, change.c_str());
+  }
+
+  if (!json.empty()) { write_json(json, results); }
+#ifdef MATE_TRACE
+  if (!trace_path.empty() && !trace::write(trace_path)) { std::cout << "trace " << trace_path << " could not be written." << std::endl; }
+#endif
+
+  return (regressions > 0) ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+// Compares the dense backends on the squaring of markov_chain::estimate_power(). Built once with
+// Eigen's own kernels (BenchmarkBlasEigen) and once with OpenBLAS (BenchmarkBlasOpenBLAS).
+//
+// usage: benchmark [threads [states...]]
+
+#include "blas.h"
+#include "markov_chain.h"
+#include "random.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+/// Random, dense transition matrix of the given number of states.
+Eigen::MatrixXd random_transition_matrix(const std::uint64_t _state_count)
+{
+  Eigen::MatrixXd result(_state_count, _state_count);
+  for (std::uint64_t i = 0; i < _state_count; i++)
+  {
+    Eigen::VectorXd row(_state_count);
+    math::fill_uniform(row);
+    result.row(i) = row.transpose() / row.sum();
+  }
+  return result;
+}
+
+}; // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::uint64_t thread_count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 0;
+  std::vector<std::uint64_t> state_counts;
+  for (int i = 2; i < argc; i++) { state_counts.push_back(std::strtoull(argv[i], nullptr, 10)); }
+  if (state_counts.empty()) { state_counts = { 250, 500, 1000, 2000, 5000 }; }
+
+  const std::uint64_t squarings = 4;
+
+  math::seed(42);
+  math::set_blas_threads(thread_count);
+  std::cout
+    << "backend " << (math::blas_enabled() ? "OpenBLAS" : "Eigen")
+    << " with " << math::blas_threads() << " threads" << std::endl;
+
+  for (const auto state_count : state_counts)
+  {
+    const Eigen::MatrixXd transition_matrix = random_transition_matrix(state_count);
+    const Eigen::RowVectorXd initial_state = Eigen::RowVectorXd::Ones(state_count) / static_cast<double>(state_count);
+    markov_chain<> chain(
+      initial_state,
+      transition_matrix,
+      std::vector<discrete_distribution>(state_count, discrete_distribution(2)));
+
+    // estimate_power() prints the estimated state vector, which is not part of the measurement
+    std::ostringstream discard;
+    std::streambuf* output = std::cout.rdbuf(discard.rdbuf());
+    const auto begin = std::chrono::steady_clock::now();
+    chain.estimate_power(squarings, -1);
+    const auto end = std::chrono::steady_clock::now();
+    std::cout.rdbuf(output);
+
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    const double flops = 2.0 * squarings * static_cast<double>(state_count) * state_count * state_count;
+    std::cout
+      << state_count << " states: " << squarings << " squarings in " << seconds << " seconds ("
+      << flops / seconds * 1.0e-9 << " GFLOP/s)" << std::endl;
+  }
+
+  return 0;
+}
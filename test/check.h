@@ -0,0 +1,38 @@
+#pragma once
+
+#include <iostream>
+
+/// Minimal assertions of the tests. A failed check is reported with its location and counted, the
+/// test passes if no check has failed.
+
+namespace check_detail {
+
+inline int& failures()
+{
+  static int count = 0;
+  return count;
+}
+
+}; // namespace check_detail
+
+/// Report and count the failure of the given condition.
+#define MATE_CHECK(_condition) \
+  do \
+  { \
+    if (!(_condition)) \
+    { \
+      std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " << #_condition << std::endl; \
+      check_detail::failures()++; \
+    } \
+  } while (false)
+
+/// \return the exit code of the test, non-zero if any check has failed.
+inline int check_result()
+{
+  if (check_detail::failures() > 0)
+  {
+    std::cout << check_detail::failures() << " check(s) failed." << std::endl;
+    return 1;
+  }
+  return 0;
+}
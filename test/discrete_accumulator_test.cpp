@@ -0,0 +1,40 @@
+// Accumulators of the same number of possible observations are merged and estimate a
+// distribution, accumulators of a different number are rejected and change nothing.
+
+#include "check.h"
+#include "discrete_accumulator.h"
+#include "discrete_distribution.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+int main()
+{
+  discrete_accumulator first(3);
+  discrete_accumulator second(3);
+  const std::vector<std::uint64_t> observations = { 0, 1, 1, 2, 2, 2, 5 };
+  first.add(observations.size(), observations.data());
+  second.add(2, 0.5);
+  second.add(0, 1.0);
+  MATE_CHECK(first.rejected() == 1);
+  MATE_CHECK(first.merge(second));
+
+  discrete_distribution distribution(Eigen::VectorXd::Ones(3));
+  MATE_CHECK(distribution.estimate(first));
+  const Eigen::VectorXd expected = (Eigen::VectorXd(3) << 2.0, 2.0, 3.5).finished() / 7.5;
+  MATE_CHECK((distribution.probabilities() - expected).norm() < 1e-12);
+
+  // a different number of observations is rejected by both
+  discrete_accumulator wider(4);
+  wider.add(3);
+  MATE_CHECK(!first.merge(wider));
+  MATE_CHECK(first.counts() == std::vector<std::uint64_t>({ 1, 2, 3 }));
+  MATE_CHECK(!distribution.estimate(wider));
+  MATE_CHECK(distribution.probabilities().size() == 3);
+  MATE_CHECK((distribution.probabilities() - expected).norm() < 1e-12);
+
+  return check_result();
+}
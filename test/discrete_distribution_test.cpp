@@ -0,0 +1,111 @@
+// Observations drawn from the alias table of a discrete distribution follow its probabilities,
+// also after the probabilities changed, and never hit an observation of probability zero. The
+// batch gathers return the probabilities of the single lookups and write nothing for a batch with
+// any observation out of bounds.
+
+#include "check.h"
+#include "discrete_distribution.h"
+#include "random.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+/// \return whether the relative frequencies of the observations match the probabilities within
+///   five standard deviations, and observations of probability zero do not occur at all.
+bool frequencies_match(const std::vector<std::uint64_t>& _observations, const Eigen::VectorXd& _probabilities)
+{
+  std::vector<double> histogram(_probabilities.size(), 0);
+  for (const std::uint64_t o : _observations)
+  {
+    if (o >= histogram.size()) { return false; }
+    histogram[o]++;
+  }
+
+  const double n = static_cast<double>(_observations.size());
+  for (std::uint64_t i = 0; i < histogram.size(); i++)
+  {
+    const double p = _probabilities[i];
+    if (p == 0 && histogram[i] > 0) { return false; }
+    if (std::abs(histogram[i] / n - p) > 5 * std::sqrt(p * (1 - p) / n)) { return false; }
+  }
+  return true;
+}
+
+}; // namespace
+
+int main()
+{
+  math::seed(3);
+  std::vector<std::uint64_t> observations(1000000);
+
+  const Eigen::VectorXd skewed = (Eigen::VectorXd(6) << 0.5, 0.05, 0.2, 0.0, 0.249, 0.001).finished();
+  discrete_distribution distribution(skewed);
+  distribution.sample(observations.size(), observations.data());
+  MATE_CHECK(frequencies_match(observations, skewed));
+
+  // the alias table is rebuilt after the probabilities changed
+  const Eigen::VectorXd changed = (Eigen::VectorXd(6) << 0.0, 0.1, 0.1, 0.4, 0.1, 0.3).finished();
+  distribution.set_probabilities(changed);
+  math::random_stream stream(3, 1);
+  distribution.sample(observations.size(), observations.data(), stream);
+  MATE_CHECK(frequencies_match(observations, changed));
+
+  // single draws use the same table
+  for (std::uint64_t& o : observations) { o = static_cast<std::uint64_t>(distribution.random()[0]); }
+  MATE_CHECK(frequencies_match(observations, changed));
+
+  // the same stream draws the same observations
+  std::vector<std::uint64_t> repeated(observations.size());
+  math::random_stream first(7, 0);
+  math::random_stream second(7, 0);
+  distribution.sample(observations.size(), observations.data(), first);
+  distribution.sample(repeated.size(), repeated.data(), second);
+  MATE_CHECK(observations == repeated);
+
+  // uniform and degenerate distributions
+  const discrete_distribution uniform(4);
+  uniform.sample(observations.size(), observations.data());
+  MATE_CHECK(frequencies_match(observations, Eigen::VectorXd::Constant(4, 0.25)));
+
+  const Eigen::VectorXd certain = (Eigen::VectorXd(3) << 0.0, 1.0, 0.0).finished();
+  const discrete_distribution degenerate(certain);
+  degenerate.sample(observations.size(), observations.data());
+  MATE_CHECK(frequencies_match(observations, certain));
+
+  // batch gathers, including the last observation and one beyond it at the end of the batch
+  const std::vector<std::uint64_t> batch = { 5, 0, 3, 3, 1, 2, 4, 5 };
+  std::vector<double> gathered(batch.size() + 1, -1);
+  MATE_CHECK(distribution.probability(batch.size(), batch.data(), gathered.data()));
+  MATE_CHECK(gathered.back() == -1);
+  for (std::uint64_t i = 0; i < batch.size(); i++)
+  {
+    MATE_CHECK(gathered[i] == changed[batch[i]]);
+    MATE_CHECK(gathered[i] == distribution.probability(Eigen::VectorXd::Constant(1, static_cast<double>(batch[i]))));
+  }
+  MATE_CHECK(distribution.log_probability(batch.size(), batch.data(), gathered.data()));
+  for (std::uint64_t i = 0; i < batch.size(); i++)
+  {
+    MATE_CHECK(gathered[i] == distribution.log_probability(Eigen::VectorXd::Constant(1, static_cast<double>(batch[i]))));
+    MATE_CHECK(std::isinf(gathered[i]) || std::abs(gathered[i] - std::log(changed[batch[i]])) < 1e-15);
+  }
+  MATE_CHECK(gathered[1] == -std::numeric_limits<double>::infinity());
+  MATE_CHECK(distribution.probability(0, batch.data(), gathered.data()));
+
+  for (const std::uint64_t beyond : { std::uint64_t(6), std::numeric_limits<std::uint64_t>::max() })
+  {
+    std::vector<std::uint64_t> invalid = batch;
+    invalid.back() = beyond;
+    std::vector<double> untouched(invalid.size(), -1);
+    MATE_CHECK(!distribution.probability(invalid.size(), invalid.data(), untouched.data()));
+    MATE_CHECK(!distribution.log_probability(invalid.size(), invalid.data(), untouched.data()));
+    MATE_CHECK(untouched == std::vector<double>(invalid.size(), -1));
+  }
+
+  return check_result();
+}
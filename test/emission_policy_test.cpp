@@ -0,0 +1,72 @@
+// A markov chain gives the same likelihoods and the same most likely states with either emission
+// policy, per_state_emissions or packed_emissions, including observations beyond the symbols of
+// some or all of the states.
+
+#include "check.h"
+#include "markov_chain.h"
+#include "packed_emissions.h"
+#include "random.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+/// \return whether both values are equal up to a relative tolerance, or both the same infinity.
+bool close(const double _a, const double _b)
+{
+  if (std::isinf(_a) || std::isinf(_b)) { return _a == _b; }
+  return std::abs(_a - _b) <= 1e-10 * std::max(1.0, std::abs(_a));
+}
+
+}; // namespace
+
+int main()
+{
+  const int state_count = 12;
+
+  math::seed(1);
+  Eigen::MatrixXd transitions(state_count, state_count);
+  Eigen::VectorXd row(state_count);
+  for (int i = 0; i < state_count; i++)
+  {
+    math::fill_uniform(row);
+    transitions.row(i) = row.transpose() / row.sum();
+  }
+  const Eigen::RowVectorXd initial_state = Eigen::RowVectorXd::Ones(state_count) / state_count;
+
+  // distributions of 3 and 4 symbols, symbol 3 is only emitted by half of the states
+  std::vector<discrete_distribution> emissions;
+  for (int i = 0; i < state_count; i++)
+  {
+    Eigen::VectorXd probabilities(3 + i % 2);
+    math::fill_uniform(probabilities);
+    emissions.push_back(discrete_distribution(probabilities));
+  }
+
+  const markov_chain<> per_state(initial_state, transitions, emissions);
+  const markov_chain<discrete_distribution, packed_emissions> packed(initial_state, transitions, emissions);
+
+  std::vector<std::uint64_t> sequence(2000);
+  for (std::uint64_t& s : sequence) { s = math::random_int(4); }
+
+  const double expected = per_state.log_likelihood(sequence);
+  MATE_CHECK(std::isfinite(expected));
+  MATE_CHECK(close(packed.log_likelihood(sequence), expected));
+  MATE_CHECK(close(packed.log_forward(sequence.size(), sequence.data()), per_state.log_forward(sequence.size(), sequence.data())));
+  MATE_CHECK(packed.viterbi(sequence) == per_state.viterbi(sequence));
+
+  // a symbol beyond every distribution cannot be emitted, with either policy
+  sequence[1000] = 4;
+  MATE_CHECK(per_state.log_likelihood(sequence) == -std::numeric_limits<double>::infinity());
+  MATE_CHECK(packed.log_likelihood(sequence) == -std::numeric_limits<double>::infinity());
+  MATE_CHECK(packed.log_forward(sequence.size(), sequence.data()) == -std::numeric_limits<double>::infinity());
+  MATE_CHECK(per_state.log_forward(sequence.size(), sequence.data()) == -std::numeric_limits<double>::infinity());
+  MATE_CHECK(packed.viterbi(sequence).size() == sequence.size());
+
+  return check_result();
+}
@@ -0,0 +1,65 @@
+// A fixed_markov_chain of 4 states, constructed from the dynamic arguments of markov_chain, gives
+// the same state vectors and likelihoods as the dynamically sized markov_chain.
+
+#include "check.h"
+#include "fixed_markov_chain.h"
+#include "markov_chain.h"
+#include "random.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+int main()
+{
+  const int state_count = 4;
+  const int symbol_count = 3;
+
+  math::seed(2);
+  Eigen::MatrixXd transitions(state_count, state_count);
+  Eigen::VectorXd row(state_count);
+  for (int i = 0; i < state_count; i++)
+  {
+    math::fill_uniform(row);
+    transitions.row(i) = row.transpose() / row.sum();
+  }
+  const Eigen::RowVectorXd initial_state = (Eigen::RowVectorXd(state_count) << 0.4, 0.3, 0.2, 0.1).finished();
+
+  // the last state emits only 2 of the 3 symbols, it is padded with a zero probability
+  std::vector<discrete_distribution> emissions;
+  for (int i = 0; i < state_count; i++)
+  {
+    Eigen::VectorXd probabilities((i == state_count - 1) ? symbol_count - 1 : symbol_count);
+    math::fill_uniform(probabilities);
+    emissions.push_back(discrete_distribution(probabilities));
+  }
+
+  markov_chain<> dynamic(initial_state, transitions, emissions);
+  const fixed_markov_chain<state_count, symbol_count> fixed(initial_state, transitions, emissions);
+
+  MATE_CHECK(fixed.initial_state() == initial_state);
+  MATE_CHECK(fixed.transition_matrix() == transitions);
+  MATE_CHECK(fixed.emission_matrix()(symbol_count - 1, state_count - 1) == 0);
+
+  MATE_CHECK((fixed.estimate(100, -1) - dynamic.estimate(100, -1)).norm() < 1e-12);
+  MATE_CHECK((fixed.estimate_power() - dynamic.estimate_power()).norm() < 1e-8);
+
+  std::vector<std::uint64_t> sequence(500);
+  for (std::uint64_t& s : sequence) { s = math::random_int(symbol_count); }
+
+  const double expected = dynamic.log_likelihood(sequence);
+  const double actual = fixed.log_likelihood(sequence.size(), sequence.data());
+  MATE_CHECK(std::isfinite(expected));
+  MATE_CHECK(std::abs(actual - expected) <= 1e-10 * std::abs(expected));
+
+  // the last symbol in a sequence, which only the padded state could have emitted
+  std::vector<std::uint64_t> impossible(1, symbol_count - 1);
+  const fixed_markov_chain<state_count, symbol_count> last_state(
+    (Eigen::RowVectorXd(state_count) << 0, 0, 0, 1).finished(), transitions, emissions);
+  MATE_CHECK(last_state.log_likelihood(impossible.size(), impossible.data()) == -std::numeric_limits<double>::infinity());
+
+  return check_result();
+}
@@ -0,0 +1,71 @@
+// The coarsest partition of a chain, which is both ordinarily and exactly lumpable into two blocks,
+// is found. Solving on the aggregate and expanding the result restores the state vectors and the
+// likelihoods of the original chain. An initial partition of the wrong size is rejected.
+
+#include "check.h"
+#include "lumpability.h"
+#include "markov_chain.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+int main()
+{
+  // states {0, 1} and {2, 3} move into and are reached from each block alike
+  Eigen::MatrixXd transitions(4, 4);
+  transitions <<
+    0.50, 0.20, 0.10, 0.20,
+    0.20, 0.50, 0.20, 0.10,
+    0.15, 0.15, 0.30, 0.40,
+    0.15, 0.15, 0.40, 0.30;
+  const Eigen::RowVectorXd initial_state = (Eigen::RowVectorXd(4) << 0.3, 0.3, 0.2, 0.2).finished();
+
+  const Eigen::VectorXd first = (Eigen::VectorXd(2) << 0.9, 0.1).finished();
+  const Eigen::VectorXd second = (Eigen::VectorXd(2) << 0.2, 0.8).finished();
+  std::vector<discrete_distribution> emissions;
+  emissions.push_back(discrete_distribution(first));
+  emissions.push_back(discrete_distribution(first));
+  emissions.push_back(discrete_distribution(second));
+  emissions.push_back(discrete_distribution(second));
+
+  const markov_chain<> chain(initial_state, transitions, emissions);
+
+  for (const lumpability::kind kind : { lumpability::kind::ordinary, lumpability::kind::exact })
+  {
+    const lumpability partition = chain.lumpable_partition(kind);
+    MATE_CHECK(partition.block_count() == 2);
+    MATE_CHECK(partition.blocks() == std::vector<std::uint64_t>({ 0, 0, 1, 1 }));
+
+    const Eigen::MatrixXd aggregated = partition.aggregate(transitions);
+    MATE_CHECK((aggregated - (Eigen::MatrixXd(2, 2) << 0.7, 0.3, 0.3, 0.7).finished()).norm() < 1e-12);
+
+    // the initial state vector is uniform within each block, so expanding is exact in every step
+    Eigen::RowVectorXd original = initial_state;
+    Eigen::RowVectorXd lumped = partition.aggregate(initial_state);
+    MATE_CHECK((partition.expand(lumped) - original).norm() < 1e-12);
+    for (int step = 0; step < 20; step++)
+    {
+      original = original * transitions;
+      lumped = lumped * aggregated;
+      MATE_CHECK((partition.expand(lumped) - original).norm() < 1e-12);
+    }
+
+    // the emissions are equal within each block, so the observations are distributed alike
+    const markov_chain<> aggregate = chain.lump(partition);
+    const std::vector<std::uint64_t> sequence = { 0, 0, 1, 1, 1, 0, 1, 0, 0, 0, 1, 1 };
+    MATE_CHECK(std::abs(aggregate.log_likelihood(sequence) - chain.log_likelihood(sequence)) < 1e-12);
+  }
+
+  // without a partition of the states that must be distinguished, everything is a single block
+  MATE_CHECK(lumpability(transitions).block_count() == 1);
+
+  // a partition of the wrong size lumps nothing
+  const lumpability rejected(transitions, lumpability::kind::ordinary, std::vector<std::uint64_t>({ 0, 0, 1 }));
+  MATE_CHECK(rejected.state_count() == 4);
+  MATE_CHECK(rejected.block_count() == 4);
+
+  return check_result();
+}
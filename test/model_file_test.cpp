@@ -0,0 +1,179 @@
+// Round trip of a markov chain through dense and sparse model files, and rejection of truncated
+// or corrupted files.
+
+#include "check.h"
+#include "markov_chain.h"
+#include "model_file.h"
+#include "random.h"
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<char> load(const std::string& _path)
+{
+  std::ifstream file(_path.c_str(), std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void save(const std::string& _path, const std::vector<char>& _data)
+{
+  std::ofstream file(_path.c_str(), std::ios::binary);
+  file.write(_data.data(), _data.size());
+}
+
+/// \return whether the given contents are accepted as a model file.
+bool opens(const std::vector<char>& _data)
+{
+  const std::string path = "model_file_test_corrupted.mmdl";
+  save(path, _data);
+  const bool result = model_file(path).is_open();
+  std::remove(path.c_str());
+  return result;
+}
+
+typedef model_file::emission_table emission_table;
+
+}; // namespace
+
+int main()
+{
+  const int state_count = 50;
+  const int symbol_count = 3;
+
+  // a sparse ring with a few shortcuts
+  Eigen::MatrixXd transitions = Eigen::MatrixXd::Zero(state_count, state_count);
+  for (int i = 0; i < state_count; i++)
+  {
+    transitions(i, (i + 1) % state_count) = 0.6;
+    transitions(i, i) = 0.3;
+    transitions(i, (i * 7) % state_count) += 0.1;
+  }
+  Eigen::RowVectorXd initial_state = Eigen::RowVectorXd::Zero(state_count);
+  initial_state[0] = 1;
+
+  std::vector<discrete_distribution> emissions;
+  for (int i = 0; i < state_count; i++)
+  {
+    Eigen::VectorXd probabilities(symbol_count);
+    probabilities << (i % 3 + 1), 1, 2;
+    emissions.push_back(discrete_distribution(probabilities));
+  }
+  const markov_chain<> chain(initial_state, transitions, emissions);
+
+  math::seed(1);
+  std::vector<std::uint64_t> sequence(2000);
+  for (std::uint64_t& s : sequence) { s = math::random_int(symbol_count); }
+  const double expected = chain.log_likelihood(sequence);
+
+  const std::string dense_path = "model_file_test_dense.mmdl";
+  const std::string sparse_path = "model_file_test_sparse.mmdl";
+  MATE_CHECK(model_file::write(dense_path, chain, false));
+  MATE_CHECK(model_file::write(sparse_path, chain, true));
+
+  {
+    const model_file dense(dense_path);
+    const model_file sparse(sparse_path);
+    MATE_CHECK(dense.is_open() && !dense.sparse());
+    MATE_CHECK(sparse.is_open() && sparse.sparse());
+    if (dense.is_open() && sparse.is_open())
+    {
+      MATE_CHECK(dense.state_count() == state_count && dense.symbol_count() == symbol_count);
+      MATE_CHECK(dense.initial_state() == initial_state);
+      MATE_CHECK(dense.transition_matrix() == transitions);
+      MATE_CHECK(std::abs(dense.log_likelihood(sequence.size(), sequence.data()) - expected) < 1e-9 * std::abs(expected));
+      MATE_CHECK(std::abs(sparse.log_likelihood(sequence.size(), sequence.data()) - expected) < 1e-9 * std::abs(expected));
+      MATE_CHECK((dense.estimate(100, -1) - sparse.estimate(100, -1)).norm() < 1e-12);
+
+      const std::uint64_t invalid = symbol_count;
+      MATE_CHECK(dense.log_likelihood(1, &invalid) == -std::numeric_limits<double>::infinity());
+    }
+  }
+
+  // the sparse overload writes the same file without a dense matrix, and rejects a mismatch
+  emission_table emission_probabilities(symbol_count, state_count);
+  for (int j = 0; j < state_count; j++) { emission_probabilities.col(j) = emissions[j].probabilities(); }
+  const Eigen::SparseMatrix<double, Eigen::RowMajor> sparse_transitions = transitions.sparseView();
+  const std::string csr_path = "model_file_test_csr.mmdl";
+  MATE_CHECK(model_file::write(csr_path, initial_state, sparse_transitions, emission_probabilities));
+  MATE_CHECK(load(csr_path) == load(sparse_path));
+  MATE_CHECK(!model_file::write(csr_path, initial_state.head(state_count - 1), sparse_transitions, emission_probabilities));
+  std::remove(csr_path.c_str());
+
+  // a model far too large for a dense matrix: a ring of a million states
+  {
+    const int ring_size = 1000000;
+    std::vector<Eigen::Triplet<double> > triplets;
+    for (int i = 0; i < ring_size; i++)
+    {
+      triplets.push_back(Eigen::Triplet<double>(i, i, 0.5));
+      triplets.push_back(Eigen::Triplet<double>(i, (i + 1) % ring_size, 0.5));
+    }
+    Eigen::SparseMatrix<double, Eigen::RowMajor> ring(ring_size, ring_size);
+    ring.setFromTriplets(triplets.begin(), triplets.end());
+    Eigen::RowVectorXd ring_state = Eigen::RowVectorXd::Zero(ring_size);
+    ring_state[0] = 1;
+
+    const std::string ring_path = "model_file_test_ring.mmdl";
+    MATE_CHECK(model_file::write(ring_path, ring_state, ring, emission_table::Ones(1, ring_size)));
+    {
+      const model_file ring_file(ring_path);
+      MATE_CHECK(ring_file.is_open() && ring_file.sparse() && ring_file.state_count() == ring_size);
+      if (ring_file.is_open())
+      {
+        Eigen::RowVectorXd next(ring_size);
+        ring_file.step(ring_state, next);
+        MATE_CHECK(next[0] == 0.5 && next[1] == 0.5 && next.sum() == 1);
+      }
+    }
+    std::remove(ring_path.c_str());
+  }
+
+  const std::vector<char> file = load(sparse_path);
+  model_file_format::header header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  MATE_CHECK(opens(file));
+
+  // truncated, with and without a consistent size in the header
+  std::vector<char> corrupted(file.begin(), file.end() - 8);
+  MATE_CHECK(!opens(corrupted));
+  model_file_format::header truncated = header;
+  truncated.size = corrupted.size();
+  std::memcpy(corrupted.data(), &truncated, sizeof(truncated));
+  MATE_CHECK(!opens(corrupted));
+  MATE_CHECK(!opens(std::vector<char>(file.begin(), file.begin() + sizeof(header) / 2)));
+
+  // a column beyond the state count
+  corrupted = file;
+  const std::uint32_t column = state_count;
+  std::memcpy(corrupted.data() + header.columns_offset + 3 * sizeof(column), &column, sizeof(column));
+  MATE_CHECK(!opens(corrupted));
+
+  // decreasing row offsets
+  corrupted = file;
+  const std::uint64_t row_offset = 5;
+  std::memcpy(corrupted.data() + header.row_offsets_offset + 10 * sizeof(row_offset), &row_offset, sizeof(row_offset));
+  MATE_CHECK(!opens(corrupted));
+
+  // a state count whose sections overflow
+  corrupted = file;
+  model_file_format::header overflowing = header;
+  overflowing.state_count = std::uint64_t(1) << 62;
+  std::memcpy(corrupted.data(), &overflowing, sizeof(overflowing));
+  MATE_CHECK(!opens(corrupted));
+
+  std::remove(dense_path.c_str());
+  std::remove(sparse_path.c_str());
+
+  return check_result();
+}
@@ -0,0 +1,65 @@
+// The histograms of a Monte Carlo simulation depend on the seed only, not on the number of worker
+// threads, and every trajectory is counted once per step.
+
+#include "check.h"
+#include "markov_chain.h"
+#include "monte_carlo.h"
+#include "random.h"
+#include "thread_pool.h"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <vector>
+
+int main()
+{
+  const int state_count = 16;
+  const int symbol_count = 2;
+  const std::uint64_t trajectories = 5000;
+  const std::uint64_t steps = 50;
+
+  math::seed(1);
+  Eigen::MatrixXd transitions(state_count, state_count);
+  Eigen::VectorXd row(state_count);
+  for (int i = 0; i < state_count; i++)
+  {
+    math::fill_uniform(row);
+    transitions.row(i) = row.transpose() / row.sum();
+  }
+  const Eigen::RowVectorXd initial_state = Eigen::RowVectorXd::Ones(state_count) / state_count;
+
+  std::vector<discrete_distribution> emissions;
+  for (int i = 0; i < state_count; i++)
+  {
+    Eigen::VectorXd probabilities(symbol_count);
+    math::fill_uniform(probabilities);
+    emissions.push_back(discrete_distribution(probabilities));
+  }
+  const markov_chain<> chain(initial_state, transitions, emissions);
+
+  const std::uint64_t thread_counts[] = { 1, 2, 4 };
+  monte_carlo::histograms expected;
+  for (const std::uint64_t thread_count : thread_counts)
+  {
+    thread_pool pool(thread_count);
+    monte_carlo simulation(chain, pool);
+    const monte_carlo::histograms result = simulation.simulate(trajectories, steps, 7);
+
+    MATE_CHECK(result.trajectories == trajectories);
+    bool counted = true;
+    for (std::uint64_t t = 0; t <= steps; t++) { counted = counted && result.occupancy.row(t).sum() == trajectories; }
+    MATE_CHECK(counted);
+
+    if (thread_count == thread_counts[0])
+    {
+      expected = result;
+      continue;
+    }
+    MATE_CHECK(result.occupancy == expected.occupancy);
+    MATE_CHECK(result.first_passage == expected.first_passage);
+    MATE_CHECK(result.emissions == expected.emissions);
+  }
+
+  return check_result();
+}
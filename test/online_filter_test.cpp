@@ -0,0 +1,121 @@
+// The online filter agrees with the batch forward algorithm on every prefix of a sequence, also
+// when the observations arrive as a protocol in chunks of arbitrary size, and stays impossible
+// after an impossible observation until it is reset.
+
+#include "check.h"
+#include "markov_chain.h"
+#include "online_filter.h"
+#include "protocol_loader.h"
+#include "protocol_stream.h"
+#include "random.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// \return whether both log-likelihoods are equal up to a relative tolerance.
+bool close(const double _a, const double _b)
+{
+  return std::abs(_a - _b) <= 1e-10 * std::max(1.0, std::abs(_b));
+}
+
+}; // namespace
+
+int main()
+{
+  const int state_count = 8;
+
+  math::seed(6);
+  Eigen::MatrixXd transitions(state_count, state_count);
+  Eigen::VectorXd row(state_count);
+  for (int i = 0; i < state_count; i++)
+  {
+    math::fill_uniform(row);
+    transitions.row(i) = row.transpose() / row.sum();
+  }
+  const Eigen::RowVectorXd initial_state = Eigen::RowVectorXd::Ones(state_count) / state_count;
+
+  // the first state never emits the second symbol
+  std::vector<discrete_distribution> emissions;
+  for (int i = 0; i < state_count; i++)
+  {
+    Eigen::VectorXd probabilities(2);
+    math::fill_uniform(probabilities);
+    if (i == 0) { probabilities[1] = 0; }
+    emissions.push_back(discrete_distribution(probabilities));
+  }
+  const markov_chain<> chain(initial_state, transitions, emissions);
+
+  std::vector<std::uint64_t> sequence(3000);
+  for (std::uint64_t& s : sequence) { s = math::random_int(2); }
+
+  // every prefix, and the filtered state against the normalized forward variables
+  online_filter<markov_chain<>> filter(chain);
+  Eigen::RowVectorXd alpha = initial_state;
+  double sum = 0;
+  for (std::uint64_t t = 0; t < sequence.size(); t++)
+  {
+    sum += filter.observe(sequence[t]);
+    if (t > 0) { alpha = alpha * transitions; }
+    for (int j = 0; j < state_count; j++) { alpha[j] *= emissions[j].probabilities()[sequence[t]]; }
+    alpha /= alpha.sum();
+
+    if (t % 250 == 0 || t + 1 == sequence.size())
+    {
+      const std::vector<std::uint64_t> prefix(sequence.begin(), sequence.begin() + t + 1);
+      MATE_CHECK(close(filter.log_likelihood(), chain.log_likelihood(prefix)));
+      MATE_CHECK((filter.state() - alpha).norm() < 1e-12);
+    }
+  }
+  MATE_CHECK(filter.observation_count() == sequence.size());
+  MATE_CHECK(close(sum, filter.log_likelihood()));
+
+  // the same observations as a protocol, fed in chunks of random size
+  std::string protocol;
+  for (std::uint64_t t = 0; t < sequence.size(); t++)
+  {
+    protocol += std::to_string(t + 1) + " " + order_to_string(static_cast<order>(sequence[t])) + "\n";
+  }
+  protocol.pop_back(); // the last line is only parsed by finish()
+
+  filter.reset();
+  MATE_CHECK(filter.observation_count() == 0);
+  MATE_CHECK(filter.log_likelihood() == 0);
+  protocol_stream stream;
+  std::vector<order> entries;
+  for (std::uint64_t offset = 0; offset < protocol.size(); )
+  {
+    const std::uint64_t size = std::min<std::uint64_t>(1 + math::random_int(40), protocol.size() - offset);
+    stream.feed(protocol.data() + offset, size, entries);
+    for (const order o : entries) { filter.observe(static_cast<std::uint64_t>(o)); }
+    entries.clear();
+    offset += size;
+  }
+  stream.finish(entries);
+  for (const order o : entries) { filter.observe(static_cast<std::uint64_t>(o)); }
+  MATE_CHECK(!stream.failed());
+  MATE_CHECK(filter.observation_count() == sequence.size());
+  MATE_CHECK(close(filter.log_likelihood(), chain.log_likelihood(sequence)));
+
+  // only the first state can emit the first observation, which cannot emit the second one
+  std::vector<discrete_distribution> certain(emissions);
+  for (int i = 1; i < state_count; i++) { certain[i] = discrete_distribution((Eigen::VectorXd(3) << 0, 1, 0).finished()); }
+  const markov_chain<> restricted(initial_state, Eigen::MatrixXd::Identity(state_count, state_count), certain);
+  online_filter<markov_chain<>> impossible(restricted);
+  const std::vector<std::uint64_t> observations = { 0, 0, 1, 0 };
+  impossible.observe(observations.size(), observations.data());
+  MATE_CHECK(impossible.log_likelihood() == -std::numeric_limits<double>::infinity());
+  MATE_CHECK(restricted.log_likelihood(observations) == -std::numeric_limits<double>::infinity());
+  impossible.reset();
+  impossible.observe(2, observations.data());
+  MATE_CHECK(close(impossible.log_likelihood(), restricted.log_likelihood({ 0, 0 })));
+
+  return check_result();
+}
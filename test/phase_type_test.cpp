@@ -0,0 +1,95 @@
+// Phase-type distributions match the first two moments they are fitted to, for high and low
+// variances and when the number of phases is limited, and the moments integrated from hazard rate
+// functions agree with the closed forms of the exponential, uniform and weibull distributions.
+
+#include "check.h"
+#include "hazard_rate.h"
+#include "phase_type.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+/// \return whether the values agree up to the given relative tolerance.
+bool close(const double _a, const double _b, const double _tolerance)
+{
+  return std::abs(_a - _b) <= _tolerance * std::abs(_b);
+}
+
+/// \return whether the distribution is proper: initial probabilities sum up to one, rates between
+///   the phases are non-negative and every row of the sub-generator with its exit rate sums to 0.
+bool proper(const phase_type& _distribution)
+{
+  if (std::abs(_distribution.initial_phases().sum() - 1) > 1e-12) { return false; }
+  const Eigen::MatrixXd& sub_generator = _distribution.sub_generator();
+  const Eigen::VectorXd exit_rates = _distribution.exit_rates();
+  for (std::uint64_t i = 0; i < _distribution.phase_count(); i++)
+  {
+    if (exit_rates[i] < -1e-12) { return false; }
+    for (std::uint64_t j = 0; j < _distribution.phase_count(); j++)
+    {
+      if (i != j && sub_generator(i, j) < 0) { return false; }
+    }
+    if (std::abs(sub_generator.row(i).sum() + exit_rates[i]) > 1e-12 * std::abs(sub_generator(i, i))) { return false; }
+  }
+  return true;
+}
+
+}; // namespace
+
+int main()
+{
+  // hyperexponential
+  const phase_type high = phase_type::fit(4.0, 2.5, 10);
+  MATE_CHECK(proper(high));
+  MATE_CHECK(high.phase_count() == 2);
+  MATE_CHECK(close(high.mean(), 4.0, 1e-12));
+  MATE_CHECK(close(high.scv(), 2.5, 1e-12));
+
+  // exponential
+  const phase_type exponential = phase_type::fit(0.5, 1.0, 10);
+  MATE_CHECK(proper(exponential));
+  MATE_CHECK(close(exponential.mean(), 0.5, 1e-12));
+  MATE_CHECK(close(exponential.scv(), 1.0, 1e-12));
+
+  // mixture of erlang distributions of 3 and 4 phases
+  const phase_type low = phase_type::fit(10.0, 0.3, 10);
+  MATE_CHECK(proper(low));
+  MATE_CHECK(low.phase_count() <= 4 + 3);
+  MATE_CHECK(close(low.mean(), 10.0, 1e-12));
+  MATE_CHECK(close(low.scv(), 0.3, 1e-12));
+
+  // too few phases for the variance, an erlang distribution of the maximum number of phases
+  const phase_type limited = phase_type::fit(10.0, 0.01, 20);
+  MATE_CHECK(proper(limited));
+  MATE_CHECK(limited.phase_count() == 20);
+  MATE_CHECK(close(limited.mean(), 10.0, 1e-12));
+  MATE_CHECK(close(limited.scv(), 1.0 / 20, 1e-12));
+
+  // moments of hazard rate functions
+  double mean;
+  double scv;
+  phase_type::moments([](const double _x) { return hazard_rate::exponential(_x, 0.25); }, mean, scv);
+  MATE_CHECK(close(mean, 4.0, 1e-3));
+  MATE_CHECK(close(scv, 1.0, 1e-3));
+
+  phase_type::moments([](const double _x) { return hazard_rate::uniform(_x, 9, 11); }, mean, scv);
+  MATE_CHECK(close(mean, 10.0, 1e-3));
+  MATE_CHECK(close(scv, (4.0 / 12) / 100, 1e-2));
+
+  phase_type::moments([](const double _x) { return hazard_rate::weibull(_x, 55, 4); }, mean, scv);
+  const double gamma = std::tgamma(1 + 1.0 / 4);
+  MATE_CHECK(close(mean, 55 * gamma, 1e-3));
+  MATE_CHECK(close(scv, std::tgamma(1 + 2.0 / 4) / (gamma * gamma) - 1, 1e-2));
+
+  // fitted from the hazard rate, the phases keep the integrated moments
+  const phase_type overheat = phase_type::fit([](const double _x) { return hazard_rate::weibull(_x, 55, 4); }, 50);
+  MATE_CHECK(proper(overheat));
+  MATE_CHECK(close(overheat.mean(), mean, 1e-9));
+  MATE_CHECK(close(overheat.scv(), scv, 1e-9));
+
+  return check_result();
+}
@@ -0,0 +1,67 @@
+// Known-answer test of the Philox4x32-10 generator against the reference vectors of Random123
+// (kat_vectors), and consistency of jumping ahead and bulk generation with single outputs.
+
+#include "check.h"
+#include "philox.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+/// Generate the two outputs of the block at the given position of a stream.
+void block(const std::uint64_t _seed, const std::uint64_t _stream, const std::uint64_t _position, std::uint64_t* _result)
+{
+  math::philox generator(_seed, _stream);
+  // the counter advances by half the skipped outputs, so positions beyond 2^63 take two jumps
+  generator.discard(_position);
+  generator.discard(_position);
+  _result[0] = generator();
+  _result[1] = generator();
+}
+
+}; // namespace
+
+int main()
+{
+  // counter (x0, x1, x2, x3) = (position, stream), key (k0, k1) = seed, outputs (x1:x0, x3:x2)
+  std::uint64_t result[2];
+
+  block(0, 0, 0, result);
+  MATE_CHECK(result[0] == 0xe169c58d6627e8d5ull);
+  MATE_CHECK(result[1] == 0x9b00dbd8bc57ac4cull);
+
+  math::philox ones(0xffffffffffffffffull, 0xffffffffffffffffull);
+  ones.discard(0xfffffffffffffffeull);
+  ones.discard(0xfffffffffffffffeull);
+  ones.discard(2);
+  MATE_CHECK(ones() == 0x41c83b0e408f276dull);
+  MATE_CHECK(ones() == 0x6d5451fda20bc7c6ull);
+
+  block(0x299f31d0a4093822ull, 0x0370734413198a2eull, 0x85a308d3243f6a88ull, result);
+  MATE_CHECK(result[0] == 0x94fdccebd16cfe09ull);
+  MATE_CHECK(result[1] == 0x24126ea15001e420ull);
+
+  // bulk generation and jumping ahead agree with successive outputs, starting mid-block
+  math::philox reference(42, 7);
+  std::vector<std::uint64_t> expected(101);
+  for (std::uint64_t& e : expected) { e = reference(); }
+
+  math::philox bulk(42, 7);
+  std::vector<std::uint64_t> generated(expected.size());
+  generated[0] = bulk();
+  bulk.generate(generated.data() + 1, generated.size() - 1);
+  MATE_CHECK(generated == expected);
+
+  math::philox skip(42, 7);
+  skip.discard(1);
+  skip.discard(36);
+  MATE_CHECK(skip() == expected[37]);
+  skip.discard(0);
+  MATE_CHECK(skip() == expected[38]);
+
+  MATE_CHECK(math::philox(42).split(7)() == expected[0]);
+  MATE_CHECK(math::philox(42, 8)() != expected[0]);
+
+  return check_result();
+}
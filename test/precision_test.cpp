@@ -0,0 +1,65 @@
+// A markov chain with a single-precision transition matrix agrees with the double-precision chain
+// within the precision of float: stationary state vectors by both methods, which terminate with
+// the default epsilon of zero, and log-likelihoods of long sequences.
+
+#include "check.h"
+#include "markov_chain.h"
+#include "packed_emissions.h"
+#include "random.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+int main()
+{
+  const int state_count = 64;
+
+  math::seed(4);
+  Eigen::MatrixXd transitions(state_count, state_count);
+  Eigen::VectorXd row(state_count);
+  for (int i = 0; i < state_count; i++)
+  {
+    math::fill_uniform(row);
+    transitions.row(i) = row.transpose() / row.sum();
+  }
+  const Eigen::RowVectorXd initial_state = Eigen::RowVectorXd::Unit(state_count, 0);
+
+  std::vector<discrete_distribution> emissions;
+  for (int i = 0; i < state_count; i++)
+  {
+    Eigen::VectorXd probabilities(4);
+    math::fill_uniform(probabilities);
+    emissions.push_back(discrete_distribution(probabilities));
+  }
+
+  markov_chain<> reference(initial_state, transitions, emissions);
+  markov_chain<discrete_distribution, per_state_emissions<discrete_distribution>, float> single(initial_state, transitions, emissions);
+  markov_chain<discrete_distribution, packed_emissions, float> packed(initial_state, transitions, emissions);
+  MATE_CHECK(sizeof(single.transition_matrix()(0, 0)) == sizeof(float));
+
+  // the precision attainable with float, as stated by estimate()
+  const double epsilon = std::numeric_limits<float>::epsilon() * std::sqrt(static_cast<double>(state_count));
+
+  const Eigen::RowVectorXd stationary = reference.estimate();
+  MATE_CHECK(std::abs(stationary.sum() - 1) < 1e-12);
+  MATE_CHECK((single.estimate() - stationary).norm() <= 10 * epsilon);
+  MATE_CHECK((single.estimate_power() - stationary).norm() <= 10 * epsilon);
+  MATE_CHECK((reference.estimate_power() - stationary).norm() <= 1e-8);
+
+  // a fixed number of steps deviates by at most the rounding of the matrix in every step
+  const std::uint64_t steps = 20;
+  MATE_CHECK((single.estimate(steps, -1) - reference.estimate(steps, -1)).norm() <= steps * epsilon);
+
+  std::vector<std::uint64_t> sequence(10000);
+  for (std::uint64_t& s : sequence) { s = math::random_int(4); }
+  const double expected = reference.log_likelihood(sequence);
+  MATE_CHECK(std::isfinite(expected));
+  MATE_CHECK(std::abs(single.log_likelihood(sequence) - expected) <= sequence.size() * std::numeric_limits<float>::epsilon());
+  MATE_CHECK(std::abs(packed.log_likelihood(sequence) - expected) <= sequence.size() * std::numeric_limits<float>::epsilon());
+
+  return check_result();
+}
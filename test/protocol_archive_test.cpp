@@ -0,0 +1,155 @@
+// Time-window reads and symbol counts of a protocol archive agree with a linear scan of the
+// protocol, for blocks of several spacings and gaps, with and without block summaries.
+
+#include "check.h"
+#include "protocol_archive.h"
+#include "random.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<char> load(const std::string& _path)
+{
+  std::ifstream file(_path.c_str(), std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/// \return whether the given contents are accepted as a protocol archive.
+bool opens(const std::vector<char>& _data)
+{
+  const std::string path = "protocol_archive_test_corrupted.mpra";
+  {
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file.write(_data.data(), _data.size());
+  }
+  const bool result = protocol_archive(path).is_open();
+  std::remove(path.c_str());
+  return result;
+}
+
+}; // namespace
+
+int main()
+{
+  math::seed(1);
+
+  // shifts of different spacings separated by gaps
+  std::vector<double> times;
+  std::vector<order> protocol;
+  double time = 0;
+  for (int shift = 0; shift < 6; shift++)
+  {
+    const double time_step = (shift % 2 == 0) ? 1.0 : 0.25;
+    const std::uint64_t length = 1000 + math::random_int(3000);
+    for (std::uint64_t i = 0; i < length; i++)
+    {
+      times.push_back(time);
+      protocol.push_back((math::random_int(5) == 0) ? order::D : order::OK);
+      time += time_step;
+    }
+    time += 500;
+  }
+
+  const std::string path = "protocol_archive_test.mpra";
+  const bool summaries[] = { true, false };
+  for (const bool summary : summaries)
+  {
+    {
+      protocol_archive_writer writer(path, 256, summary);
+      MATE_CHECK(writer.is_open());
+      bool added = true;
+      for (std::uint64_t i = 0; i < times.size(); i++) { added = added && writer.add(times[i], protocol[i]); }
+      MATE_CHECK(added);
+      MATE_CHECK(!writer.add(times.back(), order::OK));
+      MATE_CHECK(writer.close());
+    }
+
+    const protocol_archive archive(path);
+    MATE_CHECK(archive.is_open());
+    if (!archive.is_open()) { continue; }
+    MATE_CHECK(archive.entry_count() == times.size());
+
+    bool identical = true;
+    for (int query = 0; query < 300; query++)
+    {
+      double begin = -10 + math::random() * (times.back() + 20);
+      double end = begin + math::random() * 5000;
+      // windows on the exact time of an entry
+      if (query % 3 == 0)
+      {
+        begin = std::floor(begin);
+        end = std::floor(end);
+      }
+
+      std::vector<order> expected;
+      std::vector<std::uint64_t> expected_counts(2, 0);
+      for (std::uint64_t i = 0; i < times.size(); i++)
+      {
+        if (times[i] < begin || times[i] >= end) { continue; }
+        expected.push_back(protocol[i]);
+        expected_counts[static_cast<std::uint64_t>(protocol[i])]++;
+      }
+
+      std::vector<order> result;
+      identical = identical && archive.read(begin, end, result) == expected.size()
+        && result == expected && archive.count(begin, end) == expected_counts;
+    }
+    MATE_CHECK(identical);
+  }
+
+  // truncated or corrupted archives, the last one written has no summaries
+  const std::vector<char> file = load(path);
+  protocol_archive_format::header header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  MATE_CHECK(header.block_count > 2);
+  MATE_CHECK(opens(file));
+
+  MATE_CHECK(!opens(std::vector<char>(file.begin(), file.end() - 8)));
+  MATE_CHECK(!opens(std::vector<char>(file.begin(), file.begin() + header.index_offset)));
+
+  const std::uint64_t last_block = header.index_offset + (header.block_count - 1) * sizeof(protocol_archive_format::block);
+  protocol_archive_format::block block;
+  std::memcpy(&block, file.data() + last_block, sizeof(block));
+
+  std::vector<char> corrupted = file;
+  protocol_archive_format::block changed = block;
+  changed.word_offset = header.index_offset / sizeof(std::uint64_t);
+  std::memcpy(corrupted.data() + last_block, &changed, sizeof(changed));
+  MATE_CHECK(!opens(corrupted));
+
+  changed = block;
+  changed.entry_count = std::numeric_limits<std::uint64_t>::max() / 2;
+  std::memcpy(corrupted.data() + last_block, &changed, sizeof(changed));
+  MATE_CHECK(!opens(corrupted));
+
+  changed = block;
+  changed.time_step = std::numeric_limits<double>::quiet_NaN();
+  std::memcpy(corrupted.data() + last_block, &changed, sizeof(changed));
+  MATE_CHECK(!opens(corrupted));
+
+  // counts whose products overflow
+  protocol_archive_format::header overflowing = header;
+  overflowing.block_count = std::numeric_limits<std::uint64_t>::max() / sizeof(protocol_archive_format::block) + 2;
+  corrupted = file;
+  std::memcpy(corrupted.data(), &overflowing, sizeof(overflowing));
+  MATE_CHECK(!opens(corrupted));
+
+  overflowing = header;
+  overflowing.index_offset = std::numeric_limits<std::uint64_t>::max() - 7;
+  corrupted = file;
+  std::memcpy(corrupted.data(), &overflowing, sizeof(overflowing));
+  MATE_CHECK(!opens(corrupted));
+
+  std::remove(path.c_str());
+
+  return check_result();
+}
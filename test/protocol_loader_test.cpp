@@ -0,0 +1,73 @@
+// Reading a protocol file from its memory mapping gives the same entries as reading it from an
+// input stream, for well-formed files of any spacing and line ending, and stops at the same
+// malformed line.
+
+#include "check.h"
+#include "protocol_loader.h"
+#include "random.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::string path = "protocol_loader_test.txt";
+
+/// Write the given contents to the test file and read it both ways.
+/// \return whether both ways give the same entries.
+bool same_entries(const std::string& _contents, std::vector<order>& _entries)
+{
+  {
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file << _contents;
+  }
+
+  protocol_loader loader;
+  std::ifstream stream(path.c_str(), std::ios::binary);
+  const std::vector<order> streamed = loader.read(stream);
+  _entries = loader.read(path);
+  return _entries == streamed;
+}
+
+}; // namespace
+
+int main()
+{
+  std::vector<order> entries;
+
+  // a long protocol spanning many pages, with varying separators, times & line endings
+  math::seed(5);
+  std::string contents;
+  std::vector<order> expected;
+  for (std::uint64_t i = 0; i < 100000; i++)
+  {
+    const order o = (math::random_int(3) == 0) ? order::D : order::OK;
+    expected.push_back(o);
+    const char* separator = (i % 7 == 0) ? "\t" : (i % 5 == 0) ? "   " : " ";
+    const std::string time = (i % 11 == 0) ? std::to_string(i + 1) + ".0e0" : std::to_string(i + 1);
+    contents += time + separator + order_to_string(o) + ((i % 13 == 0) ? " \r\n" : "\n");
+  }
+  MATE_CHECK(same_entries(contents, entries));
+  MATE_CHECK(entries == expected);
+
+  // without a final line break
+  MATE_CHECK(same_entries("1 OK\n2 D\n3 OK", entries));
+  MATE_CHECK(entries.size() == 3);
+
+  // both stop at a line without time or without order
+  MATE_CHECK(same_entries("1 OK\n2 D\nx D\n4 OK\n", entries));
+  MATE_CHECK(entries.size() == 2);
+  MATE_CHECK(same_entries("1 OK\n2\n3 D\n", entries));
+  MATE_CHECK(entries.size() == 1);
+
+  // an empty and a missing file
+  MATE_CHECK(same_entries("", entries));
+  MATE_CHECK(entries.empty());
+  std::remove(path.c_str());
+  MATE_CHECK(protocol_loader().read(path).empty());
+
+  return check_result();
+}
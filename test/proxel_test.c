@@ -0,0 +1,230 @@
+/* Behaviour of the proxel solver of proxel_example.c. The example is compiled into this test with
+   its main() renamed, the build chooses the configuration of each variant of the test, e.g.
+   -DNAGES=3, see test/CMakeLists.txt. */
+
+#define main proxel_example_main
+#include "proxel_example.c"
+#undef main
+
+/* report and count the failure of the given condition */
+static int failures = 0;
+#define PROXEL_CHECK(_condition) \
+  do { \
+    if (!(_condition)) { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #_condition); \
+      failures++; \
+    } \
+  } while (0)
+
+/* results of the example model at the 50th step (DELTA = 1) with a working part emitted in every
+   step, by the original solver of a single age */
+#define HPM_END  4.2385903639106479e-02
+#define LPM_END  8.9035056609861763e-03
+#define WP_END   5.1289409300092667e-02
+#define PROXELS  1323
+
+/* whether the values agree up to a relative tolerance */
+static int close(double a, double b, double tolerance) {
+  return fabs(a - b) <= tolerance * fabs(b);
+}
+
+/* set up the machine model of the example, a working part is emitted in every step */
+static void setup(int kmax) {
+  int k;
+
+  e = EMISSION;
+  for (k = 0; k < 3; k++) {
+    em[k] = calloc(2, sizeof(double));
+  }
+  em[HPM][WP] = 0.95;
+  em[HPM][DP] = 0.05;
+  em[LPM][WP] = 0.8;
+  em[LPM][DP] = 0.2;
+
+  emsequence = malloc(sizeof(int) * (kmax + 2));
+  for (k = 0; k < kmax + 2; k++) {
+    emsequence[k] = WP;
+  }
+}
+
+/* whether every age but the first, which the machine model does not use, is zero */
+static int unused_ages_zero(proxel *p) {
+  int i;
+
+  if (p == NULL)
+    return 1;
+  for (i = 1; i < NAGES; i++) {
+    if (p->tauk[i] != 0)
+      return 0;
+  }
+  return unused_ages_zero(p->left) && unused_ages_zero(p->right);
+}
+
+/* ages are packed into keys of the minimal width, keys are unique & ordered by state first */
+static void check_keys(void) {
+  int s, i, w, n, digits, ages[NAGES], last[NAGES];
+  proxelkey id, previous = 0;
+
+  PROXEL_CHECK(initkeys(51));
+  PROXEL_CHECK(statebits == 2);
+  for (i = 0; i < NAGES; i++) {
+    PROXEL_CHECK(agebits[i] == 6);
+  }
+
+  /* every combination of a state and ages below 4 in increasing order of the key */
+  digits = 1;
+  for (i = 0; i < NAGES; i++) {
+    digits *= 4;
+    last[i] = 0;
+  }
+  for (s = 0; s < NSTATES; s++) {
+    for (n = 0; n < digits; n++) {
+      for (i = NAGES - 1, w = n; i >= 0; i--, w /= 4) {
+        ages[i] = w % 4;
+      }
+      id = state2id(s, ages);
+      PROXEL_CHECK((s == 0 && n == 0) || id > previous);
+      previous = id;
+      memcpy(last, ages, sizeof(last));
+    }
+  }
+  PROXEL_CHECK(last[0] == 3);
+
+  /* keys wider than 64 bits are rejected */
+  for (w = 1; w < 31; w++) {
+    PROXEL_CHECK(initkeys(1 << w) == (2 + NAGES * w <= 64));
+  }
+}
+
+/* the statistics describe a single run of the solver, proxels are taken from the tree in an order
+   of rand(), which is restarted for both runs */
+static void check_statistics(int kmax) {
+  int total, concurrent;
+  double error;
+
+  dt = 1.0;
+  initsolution(kmax);
+  srand(1);
+  PROXEL_CHECK(solve(kmax, 1));
+  total = totcnt;
+  concurrent = maxccp;
+  error = eerror;
+  PROXEL_CHECK(total > 0 && concurrent > 0 && concurrent <= total);
+
+  initsolution(kmax);
+  srand(1);
+  PROXEL_CHECK(solve(kmax, 1));
+  PROXEL_CHECK(totcnt == total);
+  PROXEL_CHECK(maxccp == concurrent);
+  PROXEL_CHECK(eerror == error);
+}
+
+/* the extrapolation of DELTA and DELTA/2 is closer to a fine reference than DELTA/2 itself, and
+   the error estimate is the difference of both */
+static void check_richardson(int kmax) {
+  const int refinement = 32;
+  double *reference[3], *ycoarse[3], *emcoarse[2], coarse[3], fine[3];
+  double fine_error = 0.0, extrapolated_error = 0.0;
+  int k, j;
+
+  dt = 1.0 / refinement;
+  initsolution(refinement * kmax);
+  PROXEL_CHECK(solve(refinement * kmax, refinement));
+  for (k = 0; k < 3; k++) {
+    reference[k] = malloc(sizeof(double) * (kmax + 1));
+    for (j = 0; j <= kmax; j++) {
+      reference[k][j] = y[k][refinement * j];
+    }
+  }
+
+  dt = 1.0;
+  initsolution(kmax);
+  PROXEL_CHECK(solve(kmax, 1));
+  for (k = 0; k < 3; k++)
+    ycoarse[k] = y[k];
+  for (k = 0; k < 2; k++)
+    emcoarse[k] = emsum[k];
+
+  dt = 0.5;
+  initsolution(2 * kmax);
+  PROXEL_CHECK(solve(2 * kmax, 2));
+  for (j = 1; j <= kmax; j++) {
+    fine_error += fabs(y[HPM][2 * j] - reference[HPM][j]);
+  }
+  for (k = 0; k < 3; k++) {
+    coarse[k] = ycoarse[k][kmax];
+    fine[k] = y[k][2 * kmax];
+  }
+
+  dt = 1.0;
+  extrapolate(kmax, ycoarse, emcoarse);
+  for (j = 1; j <= kmax; j++) {
+    extrapolated_error += fabs(y[HPM][j] - reference[HPM][j]);
+  }
+  PROXEL_CHECK(extrapolated_error < fine_error / 2);
+  for (k = 0; k < 3; k++) {
+    PROXEL_CHECK(yerr[k][kmax] == fine[k] - coarse[k]);
+    PROXEL_CHECK(fabs(y[k][kmax] - (2 * fine[k] - coarse[k])) <= 1e-15);
+  }
+}
+
+/* with NORMALIZE, the proxels hold the state distribution conditioned on the emissions so far and
+   emlog[] accumulates the log-likelihood of the sequence, which stays representable on sequences
+   far longer than the joint probability. Without, the joint probability of a long sequence falls
+   below MINPROB and every proxel is pruned. */
+static void check_normalize(void) {
+  const int kmax = 2000;
+  double sum = 0.0;
+  int k;
+
+  dt = 1.0;
+  setup(kmax);
+  initsolution(kmax);
+  PROXEL_CHECK(solve(kmax, 1));
+
+#if NORMALIZE
+  PROXEL_CHECK(close(emlog[50], log(WP_END), 1e-9));
+  for (k = 1; k <= kmax; k++) {
+    sum += log(emsum[WP][k]);
+    PROXEL_CHECK(emlog[k] < emlog[k - 1]);
+    PROXEL_CHECK(fabs(y[HPM][k] + y[LPM][k] - 1.0) < 1e-6);
+  }
+  PROXEL_CHECK(close(emlog[kmax], sum, 1e-12));
+  PROXEL_CHECK(isfinite(emlog[kmax]) && emlog[kmax] < log(MINPROB));
+#else
+  for (k = 0; k <= kmax; k++) {
+    sum += y[HPM][k] + y[LPM][k];
+  }
+  PROXEL_CHECK(y[HPM][kmax] + y[LPM][kmax] == 0.0);
+  PROXEL_CHECK(sum > 0.0);
+#endif
+}
+
+int main(void) {
+  const int kmax = 50;
+
+  check_keys();
+
+  /* the unused ages stay zero, so the solution is the one of a single age */
+  dt = 1.0;
+  setup(kmax);
+  initsolution(kmax);
+  PROXEL_CHECK(solve(kmax, 1));
+  PROXEL_CHECK(unused_ages_zero(root[sw]));
+#if !NORMALIZE
+  PROXEL_CHECK(close(y[HPM][kmax], HPM_END, 1e-12));
+  PROXEL_CHECK(close(y[LPM][kmax], LPM_END, 1e-12));
+  PROXEL_CHECK(close(emsum[WP][kmax], WP_END, 1e-12));
+  PROXEL_CHECK(totcnt == PROXELS);
+#endif
+
+  check_statistics(kmax);
+  check_richardson(kmax);
+  check_normalize();
+
+  if (failures > 0) {
+    printf("%d check(s) failed.\n", failures);
+    return 1;
+  }
+  return 0;
+}
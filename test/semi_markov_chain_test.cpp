@@ -0,0 +1,68 @@
+// A semi-markov chain with geometric durations is a hidden markov chain with self-transitions:
+// with the probability a of leaving a segment after each step, the markov chain stays in a state
+// with probability (1 - a) and otherwise makes a transition of the embedded chain. Both have to
+// agree on the likelihood and the most likely states of any sequence.
+
+#include "check.h"
+#include "markov_chain.h"
+#include "random.h"
+#include "semi_markov_chain.h"
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+int main()
+{
+  const int state_count = 3;
+  const int max_duration = 400;
+  const double leave = 0.3;
+
+  Eigen::MatrixXd transitions(state_count, state_count);
+  transitions <<
+    0.0, 0.6, 0.4,
+    0.5, 0.0, 0.5,
+    0.7, 0.3, 0.0;
+  Eigen::RowVectorXd initial_state(state_count);
+  initial_state << 0.5, 0.3, 0.2;
+
+  std::vector<discrete_distribution> emissions;
+  Eigen::VectorXd probabilities(3);
+  probabilities << 0.7, 0.2, 0.1;
+  emissions.push_back(discrete_distribution(probabilities));
+  probabilities << 0.1, 0.8, 0.1;
+  emissions.push_back(discrete_distribution(probabilities));
+  probabilities << 0.0, 0.3, 0.7;
+  emissions.push_back(discrete_distribution(probabilities));
+
+  // geometric durations, the tail beyond the maximum duration is added to the last one
+  Eigen::VectorXd geometric(max_duration);
+  for (int d = 0; d < max_duration; d++) { geometric[d] = leave * std::pow(1 - leave, d); }
+  geometric[max_duration - 1] += std::pow(1 - leave, max_duration);
+
+  const markov_chain<> embedded(initial_state, transitions, emissions);
+  const semi_markov_chain<markov_chain<> > semi_markov(embedded, std::vector<discrete_distribution>(state_count, discrete_distribution(geometric)));
+
+  const Eigen::MatrixXd self_transitions = (1 - leave) * Eigen::MatrixXd::Identity(state_count, state_count) + leave * transitions;
+  const markov_chain<> hidden_markov(initial_state, self_transitions, emissions);
+
+  math::seed(1);
+  std::vector<std::uint64_t> sequence(1000);
+  for (std::uint64_t& s : sequence) { s = math::random_int(3); }
+
+  const double expected = hidden_markov.log_forward(sequence.size(), sequence.data());
+  MATE_CHECK(std::isfinite(expected));
+  MATE_CHECK(std::abs(semi_markov.log_likelihood(sequence) - expected) < 1e-8 * std::abs(expected));
+  MATE_CHECK(semi_markov.viterbi(sequence) == hidden_markov.viterbi(sequence));
+
+  // a symbol emitted by no state is impossible
+  sequence[500] = 3;
+  MATE_CHECK(semi_markov.log_likelihood(sequence) == -std::numeric_limits<double>::infinity());
+
+  MATE_CHECK(semi_markov.max_duration() == max_duration);
+
+  return check_result();
+}
@@ -0,0 +1,143 @@
+// Every task submitted to the thread pool runs exactly once, including tasks submitted by workers,
+// and batch scoring gives the same results for any number of worker threads.
+
+#include "batch_scorer.h"
+#include "check.h"
+#include "markov_chain.h"
+#include "random.h"
+#include "thread_pool.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+/// \return a random markov chain with discrete emissions.
+markov_chain<> random_chain(const int _state_count, const int _symbol_count)
+{
+  Eigen::MatrixXd transitions(_state_count, _state_count);
+  Eigen::VectorXd row(_state_count);
+  for (int i = 0; i < _state_count; i++)
+  {
+    math::fill_uniform(row);
+    transitions.row(i) = row.transpose() / row.sum();
+  }
+  const Eigen::RowVectorXd initial_state = Eigen::RowVectorXd::Ones(_state_count) / _state_count;
+
+  std::vector<discrete_distribution> emissions;
+  for (int i = 0; i < _state_count; i++)
+  {
+    Eigen::VectorXd probabilities(_symbol_count);
+    math::fill_uniform(probabilities);
+    emissions.push_back(discrete_distribution(probabilities));
+  }
+  return markov_chain<>(initial_state, transitions, emissions);
+}
+
+}; // namespace
+
+int main()
+{
+  math::seed(1);
+  const std::uint64_t thread_counts[] = { 1, 2, 4 };
+
+  // tasks from outside and from within the pool, over several rounds of the same pool
+  {
+    thread_pool pool(4);
+    std::vector<std::atomic<int> > runs(2000);
+    for (int round = 0; round < 3; round++)
+    {
+      for (std::atomic<int>& r : runs) { r = 0; }
+      for (std::uint64_t i = 0; i < runs.size() / 2; i++)
+      {
+        pool.submit([&pool, &runs, i]
+        {
+          runs[2 * i]++;
+          pool.submit([&runs, i] { runs[2 * i + 1]++; });
+        });
+      }
+      pool.wait();
+
+      bool once = true;
+      for (const std::atomic<int>& r : runs) { once = once && r == 1; }
+      MATE_CHECK(once);
+    }
+  }
+
+  // order of execution on a single worker: own tasks newest first, then tasks from outside in the
+  // order of submission
+  {
+    thread_pool pool(1);
+    std::vector<int> order;
+    pool.submit([&pool, &order]
+    {
+      order.push_back(0);
+      for (int child = 1; child <= 3; child++) { pool.submit([&order, child] { order.push_back(child); }); }
+    });
+    for (int task = 4; task <= 6; task++) { pool.submit([&order, task] { order.push_back(task); }); }
+    pool.wait();
+
+    const int expected[] = { 0, 3, 2, 1, 4, 5, 6 };
+    MATE_CHECK(order == std::vector<int>(expected, expected + 7));
+  }
+
+  // batch scoring, results in the order of the jobs
+  std::vector<markov_chain<> > models;
+  models.push_back(random_chain(16, 2));
+  models.push_back(random_chain(40, 3));
+
+  std::vector<std::vector<std::uint64_t> > sequences(60);
+  for (std::uint64_t i = 0; i < sequences.size(); i++)
+  {
+    sequences[i].resize((i % 10 == 0) ? 20000 : 100 + math::random_int(2000));
+    for (std::uint64_t& s : sequences[i]) { s = math::random_int(2); }
+  }
+
+  std::vector<batch_scorer<markov_chain<> >::job> jobs;
+  for (std::uint64_t i = 0; i < sequences.size(); i++)
+  {
+    batch_scorer<markov_chain<> >::job j;
+    j.id = 1000 + i;
+    j.model = &models[i % models.size()];
+    j.sequence = sequences[i].data();
+    j.length = sequences[i].size();
+    jobs.push_back(j);
+  }
+
+  for (const std::uint64_t thread_count : thread_counts)
+  {
+    thread_pool pool(thread_count);
+    batch_scorer<markov_chain<> > scorer(pool);
+    const std::vector<batch_scorer<markov_chain<> >::result> results = scorer.score(jobs);
+
+    MATE_CHECK(results.size() == jobs.size());
+    bool identical = true;
+    for (std::uint64_t i = 0; i < results.size(); i++)
+    {
+      identical = identical && results[i].id == jobs[i].id
+        && results[i].log_likelihood == jobs[i].model->log_likelihood(sequences[i]);
+    }
+    MATE_CHECK(identical);
+  }
+
+  // longest processing time first, so that the longest jobs do not finish at the tail of a batch
+  {
+    thread_pool pool(1);
+    batch_scorer<markov_chain<> > scorer(pool);
+    std::vector<std::uint64_t> work;
+    scorer.score(jobs, [&jobs, &work](const batch_scorer<markov_chain<> >::result& _result)
+    {
+      const batch_scorer<markov_chain<> >::job& j = jobs[_result.id - 1000];
+      work.push_back(j.length * j.model->initial_state().size());
+    });
+
+    MATE_CHECK(work.size() == jobs.size());
+    MATE_CHECK(std::is_sorted(work.rbegin(), work.rend()));
+  }
+
+  return check_result();
+}